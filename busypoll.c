@@ -0,0 +1,314 @@
+/*
+ * Copyright © 2026 libinput contributors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+/*
+ * Busy-poll ingestion. A thread spins on non-blocking reads of every
+ * device fd and publishes what it read through a single-producer,
+ * single-consumer ring of batches. libinput_dispatch() drains the ring
+ * and decodes the batches exactly like records read after a kqueue
+ * wakeup, so the thread never touches any other libinput state.
+ *
+ * Devices are attached to the thread through slots. Detaching clears the
+ * fd of the slot, then waits until the thread finished two loops over the
+ * slots, so it no longer reads the fd, before the fd may be closed.
+ */
+
+#include <errno.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <dev/wscons/wsconsio.h>
+
+#include "libinput.h"
+#include "libinput-util.h"
+#include "libinput-private.h"
+
+#define BUSYPOLL_SLOTS		32
+#define BUSYPOLL_BATCHES	256	/* a power of two */
+#define BUSYPOLL_RECORDS	32
+
+/* Idle loops before backing off to sched_yield(), then to sleeping */
+#define BUSYPOLL_SPIN		4096
+#define BUSYPOLL_YIELD		65536
+#define BUSYPOLL_SLEEP_NSEC	50000
+
+#define CACHELINE		64
+
+struct busypoll_batch {
+	int slot;
+	int count;
+	uint64_t read_time;	/* usec, CLOCK_REALTIME like the records */
+	struct wscons_event records[BUSYPOLL_RECORDS];
+};
+
+struct busypoll {
+	pthread_t thread;
+	int running;
+	uint64_t epoch;		/* loops over the slots so far */
+
+	struct {
+		int fd;		/* -1 if free, read by the thread */
+		struct libinput_device *device;
+	} slots[BUSYPOLL_SLOTS];
+
+	/* head is written by the thread only, tail by the consumer only */
+	uint64_t head __attribute__((aligned(CACHELINE)));
+	uint64_t tail __attribute__((aligned(CACHELINE)));
+	struct busypoll_batch ring[BUSYPOLL_BATCHES];
+};
+
+static inline void
+busypoll_pause(void)
+{
+#if defined(__i386__) || defined(__amd64__) || defined(__x86_64__)
+	__builtin_ia32_pause();
+#elif defined(__aarch64__)
+	__asm__ volatile("yield");
+#endif
+}
+
+static void
+busypoll_backoff(unsigned int idle)
+{
+	struct timespec ts = { 0, BUSYPOLL_SLEEP_NSEC };
+
+	if (idle < BUSYPOLL_SPIN)
+		busypoll_pause();
+	else if (idle < BUSYPOLL_YIELD)
+		sched_yield();
+	else
+		nanosleep(&ts, NULL);
+}
+
+static bool
+busypoll_running(struct busypoll *bp)
+{
+	return __atomic_load_n(&bp->running, __ATOMIC_ACQUIRE);
+}
+
+static void *
+busypoll_thread(void *data)
+{
+	struct busypoll *bp = data;
+	struct busypoll_batch *batch;
+	struct timespec ts;
+	unsigned int idle = 0;
+	ssize_t len;
+	bool busy;
+	int i, fd;
+
+	while (busypoll_running(bp)) {
+		busy = false;
+
+		for (i = 0; i < BUSYPOLL_SLOTS; i++) {
+			fd = __atomic_load_n(&bp->slots[i].fd, __ATOMIC_ACQUIRE);
+			if (fd == -1)
+				continue;
+
+			/* Full, the kernel queue buffers meanwhile */
+			while (bp->head - __atomic_load_n(&bp->tail,
+			    __ATOMIC_ACQUIRE) == BUSYPOLL_BATCHES) {
+				if (!busypoll_running(bp))
+					return NULL;
+				busypoll_pause();
+			}
+
+			batch = &bp->ring[bp->head % BUSYPOLL_BATCHES];
+			len = read(fd, batch->records, sizeof(batch->records));
+			if (len <= 0 || (len % sizeof(struct wscons_event)) != 0)
+				continue;
+
+			clock_gettime(CLOCK_REALTIME, &ts);
+			batch->slot = i;
+			batch->count = len / sizeof(struct wscons_event);
+			batch->read_time = s2us(ts.tv_sec) + ns2us(ts.tv_nsec);
+			__atomic_store_n(&bp->head, bp->head + 1,
+					 __ATOMIC_RELEASE);
+			busy = true;
+		}
+
+		__atomic_add_fetch(&bp->epoch, 1, __ATOMIC_RELEASE);
+
+		idle = busy ? 0 : idle + 1;
+		if (!busy)
+			busypoll_backoff(idle);
+	}
+
+	return NULL;
+}
+
+void
+busypoll_drain(struct libinput *libinput)
+{
+	struct busypoll *bp = libinput->busypoll;
+	struct busypoll_batch *batch;
+	struct libinput_device *device;
+	uint64_t head;
+
+	head = __atomic_load_n(&bp->head, __ATOMIC_ACQUIRE);
+	while (bp->tail != head) {
+		batch = &bp->ring[bp->tail % BUSYPOLL_BATCHES];
+		device = bp->slots[batch->slot].device;
+		if (device != NULL)
+			wscons_device_process(device, batch->records,
+					      batch->count, batch->read_time);
+		__atomic_store_n(&bp->tail, bp->tail + 1, __ATOMIC_RELEASE);
+	}
+}
+
+int
+busypoll_add(struct libinput *libinput, struct libinput_device *device)
+{
+	struct busypoll *bp = libinput->busypoll;
+	int i;
+
+	for (i = 0; i < BUSYPOLL_SLOTS; i++) {
+		if (bp->slots[i].device != NULL)
+			continue;
+
+		bp->slots[i].device = device;
+		device->busypoll_slot = i;
+		__atomic_store_n(&bp->slots[i].fd, device->fd,
+				 __ATOMIC_RELEASE);
+		return 0;
+	}
+
+	return -ENOSPC;
+}
+
+void
+busypoll_remove(struct libinput *libinput, struct libinput_device *device)
+{
+	struct busypoll *bp = libinput->busypoll;
+	int slot = device->busypoll_slot;
+	uint64_t epoch;
+
+	__atomic_store_n(&bp->slots[slot].fd, -1, __ATOMIC_RELEASE);
+
+	/*
+	 * A loop that started before the store may still read the fd. Keep
+	 * draining meanwhile so a thread waiting for room makes progress.
+	 */
+	epoch = __atomic_load_n(&bp->epoch, __ATOMIC_ACQUIRE);
+	while (__atomic_load_n(&bp->epoch, __ATOMIC_ACQUIRE) < epoch + 2) {
+		busypoll_drain(libinput);
+		busypoll_pause();
+	}
+	busypoll_drain(libinput);
+
+	bp->slots[slot].device = NULL;
+	device->busypoll_slot = -1;
+}
+
+void
+busypoll_destroy(struct libinput *libinput)
+{
+	struct busypoll *bp = libinput->busypoll;
+
+	if (bp == NULL)
+		return;
+
+	__atomic_store_n(&bp->running, 0, __ATOMIC_RELEASE);
+	pthread_join(bp->thread, NULL);
+
+	libinput->busypoll = NULL;
+	free(bp);
+}
+
+LIBINPUT_EXPORT int
+libinput_busypoll_enable(struct libinput *libinput)
+{
+	struct libinput_seat *seat;
+	struct libinput_device *device;
+	struct busypoll *bp;
+	int i, rc;
+
+	if (libinput->busypoll != NULL)
+		return 0;
+
+	bp = zalloc(sizeof(*bp));
+	if (bp == NULL)
+		return -ENOMEM;
+
+	for (i = 0; i < BUSYPOLL_SLOTS; i++)
+		bp->slots[i].fd = -1;
+	bp->running = 1;
+
+	rc = pthread_create(&bp->thread, NULL, busypoll_thread, bp);
+	if (rc != 0) {
+		free(bp);
+		return -rc;
+	}
+	libinput->busypoll = bp;
+
+	/* Move the open devices off the kqueue */
+	list_for_each(seat, &libinput->seat_list, link) {
+		list_for_each(device, &seat->devices_list, link) {
+			if (device->source == NULL)
+				continue;
+			wscons_device_unlisten(device);
+			if (wscons_device_listen(device) != 0)
+				log_error(libinput,
+					  "%s: failed to listen for events\n",
+					  device->devname);
+		}
+	}
+
+	return 0;
+}
+
+LIBINPUT_EXPORT void
+libinput_busypoll_disable(struct libinput *libinput)
+{
+	struct libinput_seat *seat;
+	struct libinput_device *device;
+
+	if (libinput->busypoll == NULL)
+		return;
+
+	list_for_each(seat, &libinput->seat_list, link) {
+		list_for_each(device, &seat->devices_list, link) {
+			if (device->busypoll_slot != -1)
+				busypoll_remove(libinput, device);
+		}
+	}
+
+	busypoll_destroy(libinput);
+
+	/* Back to the kqueue for the open devices */
+	list_for_each(seat, &libinput->seat_list, link) {
+		list_for_each(device, &seat->devices_list, link) {
+			if (device->fd == -1 || device->source != NULL)
+				continue;
+			if (wscons_device_listen(device) != 0)
+				log_error(libinput,
+					  "%s: failed to listen for events\n",
+					  device->devname);
+		}
+	}
+}
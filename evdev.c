@@ -0,0 +1,970 @@
+/*
+ * Copyright © 2026 libinput contributors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+
+/*
+ * evdev(4) nodes. wscons has no notion of tablet pads, their buttons,
+ * rings and strips are read from the evdev node of the pad instead. Such
+ * nodes are added with libinput_path_add_device() like any other device.
+ *
+ * Buttons are numbered in the order of their codes. All buttons, rings
+ * and strips form a single mode group. Pads with a ring have four modes
+ * switched by the first button, the layout of the Wacom Intuos, others
+ * have a single mode. The mode is kept in the group and every event
+ * carries the mode it was posted in.
+ *
+ * Ring and strip positions are posted at the end of a frame, and only if
+ * they changed since they were last posted.
+ *
+ * Touchscreens are read with the multitouch protocol, every slot is a
+ * touch. The pen of a combined tablet-touchscreen is only tracked to
+ * suppress touches: while it is in proximity it is the pen of its device
+ * group, and touches within a square around it are dropped before any
+ * event is built. A touch already down when the pen reaches it is
+ * cancelled, a suppressed touch stays so until it lifts.
+ *
+ * Lid and tablet mode switches may come with any of the above. Their
+ * state is read when the device is opened, a switch found on posts a
+ * toggle event, one found off does not. A closed lid optionally suspends
+ * the internal devices of the seat.
+ */
+
+#include <sys/ioctl.h>
+
+#include <errno.h>
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "libinput.h"
+#include "libinput-util.h"
+#include "libinput-private.h"
+
+#define EVDEV_READ_RECORDS	32
+
+/* Modes of a pad whose first button switches the mode of the ring */
+#define PAD_RING_MODES		4
+
+/* Half the side of the square around the pen where touches are dropped */
+#define TOUCH_ARBITRATION_MM		50
+#define TOUCH_ARBITRATION_FRACTION	0.15
+
+static const int pad_ring_codes[PAD_MAX_RINGS] = { ABS_WHEEL, ABS_THROTTLE };
+static const int pad_strip_codes[PAD_MAX_STRIPS] = { ABS_RX, ABS_RY };
+
+bool
+evdev_is_device_path(const char *path)
+{
+	return strncmp(path, "/dev/input/event", 16) == 0;
+}
+
+static uint64_t
+evdev_time(const struct input_event *ev)
+{
+	return s2us(ev->time.tv_sec) + ev->time.tv_usec;
+}
+
+/* The record time of state queried rather than read, like evdev_time() */
+static uint64_t
+evdev_now(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_REALTIME, &ts);
+	return s2us(ts.tv_sec) + ns2us(ts.tv_nsec);
+}
+
+static uint32_t
+pad_mask(unsigned int n)
+{
+	return n >= 32 ? ~0U : (1U << n) - 1;
+}
+
+static unsigned int
+pad_probe_axes(struct libinput_device *device,
+	       const unsigned long *absbits,
+	       const int *codes,
+	       struct pad_axis *axes,
+	       unsigned int max_axes)
+{
+	struct input_absinfo absinfo;
+	unsigned int i, n = 0;
+
+	for (i = 0; i < max_axes; i++) {
+		if (!long_bit_is_set(absbits, codes[i]) ||
+		    ioctl(device->fd, EVIOCGABS(codes[i]), &absinfo) == -1 ||
+		    absinfo.maximum <= absinfo.minimum)
+			continue;
+
+		axes[n].code = codes[i];
+		axes[n].minimum = absinfo.minimum;
+		axes[n].maximum = absinfo.maximum;
+		axes[n].value = absinfo.value;
+		axes[n].posted = absinfo.value;
+		n++;
+	}
+
+	return n;
+}
+
+/* The mode and the caller's data survive the device being reopened */
+static void
+pad_init_group(struct libinput_device *device)
+{
+	struct libinput_tablet_pad_mode_group *group = &device->pad.group;
+
+	group->device = device;
+	group->index = 0;
+	group->buttons = pad_mask(device->pad.nbuttons);
+	group->rings = pad_mask(device->pad.nrings);
+	group->strips = pad_mask(device->pad.nstrips);
+
+	if (device->pad.nrings > 0 && device->pad.nbuttons > 0) {
+		group->num_modes = PAD_RING_MODES;
+		group->toggles = 0x1;
+	} else {
+		group->num_modes = 1;
+		group->toggles = 0;
+	}
+
+	if (group->mode >= group->num_modes)
+		group->mode = 0;
+}
+
+static void
+pad_probe(struct libinput_device *device,
+	  const unsigned long *keybits,
+	  const unsigned long *absbits)
+{
+	unsigned int code, n = 0;
+
+	/* Pens have the buttons of their tablet on a node of their own */
+	if (!long_bit_is_set(keybits, BTN_0) ||
+	    long_bit_is_set(keybits, BTN_TOOL_PEN))
+		return;
+
+	for (code = BTN_MISC; code < BTN_DIGI && n < PAD_MAX_BUTTONS; code++) {
+		if (long_bit_is_set(keybits, code))
+			device->pad.codes[n++] = code;
+	}
+	device->pad.nbuttons = n;
+
+	/* What is held now was never pressed as far as the caller knows */
+	device->pad.buttons = 0;
+	device->pad.posted = 0;
+	device->pad.terminator = false;
+
+	device->pad.nrings = pad_probe_axes(device, absbits, pad_ring_codes,
+					    device->pad.rings, PAD_MAX_RINGS);
+	device->pad.nstrips = pad_probe_axes(device, absbits, pad_strip_codes,
+					     device->pad.strips,
+					     PAD_MAX_STRIPS);
+
+	pad_init_group(device);
+	device->caps |= bit(LIBINPUT_DEVICE_CAP_TABLET_PAD);
+}
+
+static void
+evdev_set_abs(struct libinput_device *device,
+	      const struct input_absinfo *x,
+	      const struct input_absinfo *y)
+{
+	device->abs.valid = x->maximum > x->minimum && y->maximum > y->minimum;
+	device->abs.min.x = x->minimum;
+	device->abs.min.y = y->minimum;
+	device->abs.max.x = x->maximum;
+	device->abs.max.y = y->maximum;
+	device->abs.res.x = x->resolution;
+	device->abs.res.y = y->resolution;
+}
+
+static void
+touch_probe(struct libinput_device *device,
+	    const unsigned long *keybits,
+	    const unsigned long *absbits)
+{
+	struct input_absinfo slot, x, y;
+	struct touch_slot *t;
+	unsigned int i;
+
+	/* Touchpads have finger tools and are read through wscons */
+	if (!long_bit_is_set(absbits, ABS_MT_SLOT) ||
+	    !long_bit_is_set(absbits, ABS_MT_POSITION_X) ||
+	    !long_bit_is_set(absbits, ABS_MT_POSITION_Y) ||
+	    long_bit_is_set(keybits, BTN_TOOL_FINGER))
+		return;
+
+	if (ioctl(device->fd, EVIOCGABS(ABS_MT_SLOT), &slot) == -1 ||
+	    ioctl(device->fd, EVIOCGABS(ABS_MT_POSITION_X), &x) == -1 ||
+	    ioctl(device->fd, EVIOCGABS(ABS_MT_POSITION_Y), &y) == -1 ||
+	    slot.maximum < 0)
+		return;
+
+	evdev_set_abs(device, &x, &y);
+	device->touch.nslots = min(slot.maximum + 1, TOUCH_MAX_SLOTS);
+	device->touch.slot = slot.value;
+
+	/* Contacts down now were never touched as far as the caller knows */
+	for (i = 0; i < device->touch.nslots; i++) {
+		t = &device->touch.slots[i];
+		t->tracking_id = -1;
+		t->dirty = false;
+		t->down = false;
+		t->suppressed = false;
+		t->seat_slot = -1;
+	}
+
+	device->caps |= bit(LIBINPUT_DEVICE_CAP_TOUCH);
+}
+
+static void
+pen_probe(struct libinput_device *device,
+	  const unsigned long *keybits,
+	  const unsigned long *absbits)
+{
+	struct input_absinfo x, y;
+
+	if (!long_bit_is_set(keybits, BTN_TOOL_PEN) ||
+	    !long_bit_is_set(absbits, ABS_X) ||
+	    !long_bit_is_set(absbits, ABS_Y) ||
+	    ioctl(device->fd, EVIOCGABS(ABS_X), &x) == -1 ||
+	    ioctl(device->fd, EVIOCGABS(ABS_Y), &y) == -1)
+		return;
+
+	evdev_set_abs(device, &x, &y);
+	device->pen.enabled = true;
+	device->pen.proximity = false;
+	device->pen.point.x = x.value;
+	device->pen.point.y = y.value;
+}
+
+static void
+switch_resync(struct libinput_device *device)
+{
+	unsigned long sw[NLONGS(SW_CNT)] = { 0 };
+
+	/* Switches it fails to report are assumed to be off */
+	if (ioctl(device->fd, EVIOCGSW(sizeof(sw)), sw) == -1)
+		memset(sw, 0, sizeof(sw));
+
+	device->sw.state = 0;
+	if (long_bit_is_set(sw, SW_LID))
+		device->sw.state |= bit(LIBINPUT_SWITCH_LID);
+	if (long_bit_is_set(sw, SW_TABLET_MODE))
+		device->sw.state |= bit(LIBINPUT_SWITCH_TABLET_MODE);
+	device->sw.state &= device->sw.available;
+}
+
+static void
+switch_probe(struct libinput_device *device)
+{
+	unsigned long swbits[NLONGS(SW_CNT)] = { 0 };
+
+	device->sw.available = 0;
+	if (ioctl(device->fd, EVIOCGBIT(EV_SW, sizeof(swbits)), swbits) == -1)
+		return;
+
+	if (long_bit_is_set(swbits, SW_LID))
+		device->sw.available |= bit(LIBINPUT_SWITCH_LID);
+	if (long_bit_is_set(swbits, SW_TABLET_MODE))
+		device->sw.available |= bit(LIBINPUT_SWITCH_TABLET_MODE);
+	if (device->sw.available == 0)
+		return;
+
+	switch_resync(device);
+	device->caps |= bit(LIBINPUT_DEVICE_CAP_SWITCH);
+}
+
+static void
+switch_update_lid(struct libinput_device *device)
+{
+	bool closed = device->sw.posted & bit(LIBINPUT_SWITCH_LID);
+
+	if (device->sw.lid_suspend)
+		wscons_seat_set_lid_closed(device->seat, closed);
+}
+
+/* Only what changed since the last event, the state survives reopening */
+static void
+switch_flush(struct libinput_device *device, uint64_t time)
+{
+	uint32_t changed = device->sw.state ^ device->sw.posted;
+	enum libinput_switch_state state;
+	enum libinput_switch sw;
+
+	for (sw = LIBINPUT_SWITCH_LID; sw <= LIBINPUT_SWITCH_TABLET_MODE; sw++) {
+		if (!(changed & bit(sw)))
+			continue;
+
+		state = (device->sw.state & bit(sw)) ? LIBINPUT_SWITCH_STATE_ON :
+						       LIBINPUT_SWITCH_STATE_OFF;
+		switch_notify_toggle(device, time, sw, state);
+	}
+
+	device->sw.posted = device->sw.state;
+	switch_update_lid(device);
+}
+
+/*
+ * The nodes of one piece of hardware share its ids, and its physical path
+ * up to the input number.
+ */
+bool
+evdev_device_group_id(struct libinput_device *device, char *id, size_t len)
+{
+	struct input_id ids;
+	char phys[64] = "";
+	char *slash;
+
+	if (ioctl(device->fd, EVIOCGID, &ids) == -1 ||
+	    ioctl(device->fd, EVIOCGPHYS(sizeof(phys) - 1), phys) == -1 ||
+	    phys[0] == '\0')
+		return false;
+
+	slash = strrchr(phys, '/');
+	if (slash != NULL)
+		*slash = '\0';
+
+	return snprintf(id, len, "%x:%x:%x:%s", ids.bustype, ids.vendor,
+			ids.product, phys) < (int)len;
+}
+
+void
+evdev_device_probe(struct libinput_device *device)
+{
+	struct libinput *libinput = device->seat->libinput;
+	unsigned long keybits[NLONGS(KEY_CNT)] = { 0 };
+	unsigned long absbits[NLONGS(ABS_CNT)] = { 0 };
+
+	device->evdev.dropped = false;
+	device->caps = 0;
+	device->abs.valid = false;
+	device->touch.nslots = 0;
+	device->pen.enabled = false;
+
+	if (ioctl(device->fd, EVIOCGBIT(EV_KEY, sizeof(keybits)),
+	    keybits) == -1 ||
+	    ioctl(device->fd, EVIOCGBIT(EV_ABS, sizeof(absbits)),
+	    absbits) == -1) {
+		log_error(libinput, "%s: failed to query the device: %s\n",
+			  device->devname, strerror(errno));
+		return;
+	}
+
+	pad_probe(device, keybits, absbits);
+	if (device->caps == 0)
+		touch_probe(device, keybits, absbits);
+	if (device->caps == 0)
+		pen_probe(device, keybits, absbits);
+	switch_probe(device);
+	if (device->caps & bit(LIBINPUT_DEVICE_CAP_SWITCH))
+		switch_flush(device, evdev_now());
+
+	if (device->pen.enabled)
+		log_info(libinput,
+			 "%s: pen, only tracked to suppress touches\n",
+			 device->devname);
+	else if (device->caps == 0)
+		log_info(libinput, "%s: no supported capabilities, ignored\n",
+			 device->devname);
+}
+
+static int
+pad_button_number(struct libinput_device *device, unsigned int code)
+{
+	unsigned int i;
+
+	for (i = 0; i < device->pad.nbuttons; i++) {
+		if (device->pad.codes[i] == code)
+			return i;
+	}
+
+	return -1;
+}
+
+static struct pad_axis *
+pad_axis_find(struct pad_axis *axes, unsigned int n, unsigned int code)
+{
+	unsigned int i;
+
+	for (i = 0; i < n; i++) {
+		if (axes[i].code == (int)code)
+			return &axes[i];
+	}
+
+	return NULL;
+}
+
+static void
+pad_process(struct libinput_device *device, const struct input_event *ev)
+{
+	struct pad_axis *axis;
+	int button;
+
+	switch (ev->type) {
+	case EV_KEY:
+		button = pad_button_number(device, ev->code);
+		if (button == -1)
+			break;
+		if (ev->value)
+			device->pad.buttons |= bit(button);
+		else
+			device->pad.buttons &= ~bit(button);
+		break;
+	case EV_ABS:
+		if (ev->code == ABS_MISC) {
+			device->pad.terminator = ev->value == 0;
+			break;
+		}
+
+		axis = pad_axis_find(device->pad.rings, device->pad.nrings,
+				     ev->code);
+		if (axis == NULL)
+			axis = pad_axis_find(device->pad.strips,
+					     device->pad.nstrips, ev->code);
+		if (axis != NULL)
+			axis->value = ev->value;
+		break;
+	}
+}
+
+static double
+pad_ring_position(const struct pad_axis *axis)
+{
+	double range = axis->maximum - axis->minimum + 1;
+
+	return 360.0 * (axis->value - axis->minimum) / range;
+}
+
+/* Wacom strips set one bit per position */
+static double
+pad_strip_position(const struct pad_axis *axis)
+{
+	if (axis->value <= 0 || axis->maximum <= 1)
+		return 0.0;
+
+	return min(1.0, log2(axis->value) / log2(axis->maximum));
+}
+
+static void
+pad_flush_axes(struct libinput_device *device, uint64_t time)
+{
+	struct libinput_tablet_pad_mode_group *group = &device->pad.group;
+	bool lifted = device->pad.terminator;
+	struct pad_axis *axis;
+	unsigned int i;
+
+	for (i = 0; i < device->pad.nrings; i++) {
+		axis = &device->pad.rings[i];
+		if (axis->value == axis->posted)
+			continue;
+
+		axis->posted = axis->value;
+		tablet_pad_notify_ring(device, time, i,
+				       lifted ? -1.0 : pad_ring_position(axis),
+				       LIBINPUT_TABLET_PAD_RING_SOURCE_FINGER,
+				       group);
+	}
+
+	for (i = 0; i < device->pad.nstrips; i++) {
+		axis = &device->pad.strips[i];
+		if (axis->value == axis->posted)
+			continue;
+
+		axis->posted = axis->value;
+		tablet_pad_notify_strip(device, time, i,
+					lifted ? -1.0 : pad_strip_position(axis),
+					LIBINPUT_TABLET_PAD_STRIP_SOURCE_FINGER,
+					group);
+	}
+
+	device->pad.terminator = false;
+}
+
+/* A press on a toggle button already carries the mode it switched to */
+static void
+pad_flush_buttons(struct libinput_device *device, uint64_t time)
+{
+	struct libinput_tablet_pad_mode_group *group = &device->pad.group;
+	uint32_t changed = device->pad.buttons ^ device->pad.posted;
+	enum libinput_button_state state;
+	unsigned int i;
+
+	for (i = 0; i < device->pad.nbuttons; i++) {
+		if (!(changed & bit(i)))
+			continue;
+
+		if (device->pad.buttons & bit(i)) {
+			state = LIBINPUT_BUTTON_STATE_PRESSED;
+			if (group->toggles & bit(i))
+				group->mode = (group->mode + 1) %
+					      group->num_modes;
+		} else {
+			state = LIBINPUT_BUTTON_STATE_RELEASED;
+		}
+
+		tablet_pad_notify_button(device, time, i, state, group);
+	}
+
+	device->pad.posted = device->pad.buttons;
+}
+
+static void
+pad_resync_axes(struct libinput_device *device,
+		struct pad_axis *axes,
+		unsigned int n)
+{
+	struct input_absinfo absinfo;
+	unsigned int i;
+
+	for (i = 0; i < n; i++) {
+		if (ioctl(device->fd, EVIOCGABS(axes[i].code), &absinfo) == 0)
+			axes[i].value = absinfo.value;
+	}
+}
+
+/*
+ * The kernel dropped records, take the state from the device instead.
+ * Buttons it fails to report are assumed to be released.
+ */
+static void
+pad_resync(struct libinput_device *device)
+{
+	unsigned long keys[NLONGS(KEY_CNT)] = { 0 };
+	unsigned int i;
+
+	if (ioctl(device->fd, EVIOCGKEY(sizeof(keys)), keys) == -1)
+		memset(keys, 0, sizeof(keys));
+
+	device->pad.buttons = 0;
+	for (i = 0; i < device->pad.nbuttons; i++) {
+		if (long_bit_is_set(keys, device->pad.codes[i]))
+			device->pad.buttons |= bit(i);
+	}
+
+	pad_resync_axes(device, device->pad.rings, device->pad.nrings);
+	pad_resync_axes(device, device->pad.strips, device->pad.nstrips);
+	device->pad.terminator = false;
+}
+
+static void
+touch_process(struct libinput_device *device, const struct input_event *ev)
+{
+	struct touch_slot *t;
+
+	if (ev->type != EV_ABS)
+		return;
+
+	if (ev->code == ABS_MT_SLOT) {
+		device->touch.slot = ev->value;
+		return;
+	}
+
+	if (device->touch.slot < 0 ||
+	    device->touch.slot >= (int)device->touch.nslots)
+		return;
+
+	t = &device->touch.slots[device->touch.slot];
+	switch (ev->code) {
+	case ABS_MT_TRACKING_ID:
+		t->tracking_id = ev->value;
+		t->dirty = true;
+		break;
+	case ABS_MT_POSITION_X:
+		t->point.x = ev->value;
+		t->dirty = true;
+		break;
+	case ABS_MT_POSITION_Y:
+		t->point.y = ev->value;
+		t->dirty = true;
+		break;
+	}
+}
+
+static int
+touch_seat_slot_get(struct libinput_seat *seat)
+{
+	int i;
+
+	for (i = 0; i < 32; i++) {
+		if (!(seat->slot_map & bit(i))) {
+			seat->slot_map |= bit(i);
+			return i;
+		}
+	}
+
+	return -1;
+}
+
+static void
+touch_seat_slot_put(struct libinput_seat *seat, int seat_slot)
+{
+	if (seat_slot >= 0)
+		seat->slot_map &= ~bit(seat_slot);
+}
+
+/* The pen and the touchscreen cover the same panel, scale between them */
+static bool
+touch_near_pen(struct libinput_device *device,
+	       struct libinput_device *pen,
+	       int axis,
+	       int value)
+{
+	double tmin = axis ? device->abs.min.y : device->abs.min.x;
+	double tmax = axis ? device->abs.max.y : device->abs.max.x;
+	int res = axis ? device->abs.res.y : device->abs.res.x;
+	double pmin = axis ? pen->abs.min.y : pen->abs.min.x;
+	double pmax = axis ? pen->abs.max.y : pen->abs.max.x;
+	double p = axis ? pen->pen.point.y : pen->pen.point.x;
+	double pos, margin;
+
+	pos = tmin + (p - pmin) * (tmax - tmin) / (pmax - pmin);
+	margin = res > 0 ? TOUCH_ARBITRATION_MM * res :
+			   (tmax - tmin) * TOUCH_ARBITRATION_FRACTION;
+
+	return fabs(value - pos) <= margin;
+}
+
+/* Without ranges to compare, the pen covers the whole screen */
+static bool
+touch_under_pen(struct libinput_device *device,
+		const struct device_coords *point)
+{
+	struct libinput_device *pen = device->group->pen;
+
+	if (pen == NULL)
+		return false;
+	if (!device->abs.valid || !pen->abs.valid)
+		return true;
+
+	return touch_near_pen(device, pen, 0, point->x) &&
+	       touch_near_pen(device, pen, 1, point->y);
+}
+
+/*
+ * Touches under the pen are checked on every frame, not only when they
+ * moved, so a resting palm is cancelled as soon as the pen reaches it.
+ */
+static void
+touch_flush(struct libinput_device *device, uint64_t time)
+{
+	struct libinput_seat *seat = device->seat;
+	struct touch_slot *t;
+	bool dirty, posted = false;
+	unsigned int i;
+
+	for (i = 0; i < device->touch.nslots; i++) {
+		t = &device->touch.slots[i];
+		dirty = t->dirty;
+		t->dirty = false;
+
+		if (t->tracking_id == -1) {
+			if (t->down) {
+				touch_notify_touch_up(device, time, i,
+						      t->seat_slot);
+				touch_seat_slot_put(seat, t->seat_slot);
+				posted = true;
+			}
+			t->down = false;
+			t->suppressed = false;
+			continue;
+		}
+
+		if (t->suppressed)
+			continue;
+
+		if (touch_under_pen(device, &t->point)) {
+			t->suppressed = true;
+			device->stats.suppressed_touches++;
+			if (t->down) {
+				touch_notify_touch_cancel(device, time, i,
+							  t->seat_slot);
+				touch_seat_slot_put(seat, t->seat_slot);
+				posted = true;
+			}
+			t->down = false;
+			continue;
+		}
+
+		if (t->down) {
+			if (dirty) {
+				touch_notify_touch_motion(device, time, i,
+							  t->seat_slot,
+							  &t->point);
+				posted = true;
+			}
+			continue;
+		}
+
+		/* Out of seat slots, retried on the next frame */
+		t->seat_slot = touch_seat_slot_get(seat);
+		if (t->seat_slot == -1)
+			continue;
+
+		t->down = true;
+		touch_notify_touch_down(device, time, i, t->seat_slot,
+					&t->point);
+		posted = true;
+	}
+
+	if (posted)
+		touch_notify_frame(device, time);
+}
+
+/*
+ * The kernel dropped records, take the contacts from the device instead.
+ * A slot that changed its contact meanwhile lifts the old one first.
+ */
+static void
+touch_resync(struct libinput_device *device, uint64_t time)
+{
+	struct {
+		uint32_t code;
+		int32_t values[TOUCH_MAX_SLOTS];
+	} ids, xs, ys;
+	struct input_absinfo slot;
+	struct touch_slot *t;
+	unsigned int i;
+
+	ids.code = ABS_MT_TRACKING_ID;
+	xs.code = ABS_MT_POSITION_X;
+	ys.code = ABS_MT_POSITION_Y;
+	if (ioctl(device->fd, EVIOCGMTSLOTS(sizeof(ids)), &ids) == -1 ||
+	    ioctl(device->fd, EVIOCGMTSLOTS(sizeof(xs)), &xs) == -1 ||
+	    ioctl(device->fd, EVIOCGMTSLOTS(sizeof(ys)), &ys) == -1) {
+		for (i = 0; i < TOUCH_MAX_SLOTS; i++)
+			ids.values[i] = -1;
+	}
+
+	for (i = 0; i < device->touch.nslots; i++) {
+		t = &device->touch.slots[i];
+		if (t->tracking_id != -1 && t->tracking_id != ids.values[i]) {
+			t->tracking_id = -1;
+			t->dirty = true;
+		}
+	}
+	touch_flush(device, time);
+
+	for (i = 0; i < device->touch.nslots; i++) {
+		t = &device->touch.slots[i];
+		t->tracking_id = ids.values[i];
+		if (t->tracking_id == -1)
+			continue;
+		t->point.x = xs.values[i];
+		t->point.y = ys.values[i];
+		t->dirty = true;
+	}
+
+	if (ioctl(device->fd, EVIOCGABS(ABS_MT_SLOT), &slot) == 0)
+		device->touch.slot = slot.value;
+}
+
+static void
+pen_process(struct libinput_device *device, const struct input_event *ev)
+{
+	switch (ev->type) {
+	case EV_KEY:
+		if (ev->code == BTN_TOOL_PEN || ev->code == BTN_TOOL_RUBBER)
+			device->pen.proximity = ev->value != 0;
+		break;
+	case EV_ABS:
+		if (ev->code == ABS_X)
+			device->pen.point.x = ev->value;
+		else if (ev->code == ABS_Y)
+			device->pen.point.y = ev->value;
+		break;
+	}
+}
+
+static void
+pen_flush(struct libinput_device *device)
+{
+	struct libinput_device_group *group = device->group;
+
+	if (device->pen.proximity)
+		group->pen = device;
+	else if (group->pen == device)
+		group->pen = NULL;
+}
+
+static void
+pen_resync(struct libinput_device *device)
+{
+	unsigned long keys[NLONGS(KEY_CNT)] = { 0 };
+	struct input_absinfo absinfo;
+
+	if (ioctl(device->fd, EVIOCGKEY(sizeof(keys)), keys) == -1)
+		memset(keys, 0, sizeof(keys));
+
+	device->pen.proximity = long_bit_is_set(keys, BTN_TOOL_PEN) ||
+				long_bit_is_set(keys, BTN_TOOL_RUBBER);
+
+	if (ioctl(device->fd, EVIOCGABS(ABS_X), &absinfo) == 0)
+		device->pen.point.x = absinfo.value;
+	if (ioctl(device->fd, EVIOCGABS(ABS_Y), &absinfo) == 0)
+		device->pen.point.y = absinfo.value;
+}
+
+static void
+switch_process(struct libinput_device *device, const struct input_event *ev)
+{
+	uint32_t mask;
+
+	if (ev->code == SW_LID)
+		mask = bit(LIBINPUT_SWITCH_LID);
+	else if (ev->code == SW_TABLET_MODE)
+		mask = bit(LIBINPUT_SWITCH_TABLET_MODE);
+	else
+		return;
+
+	if (ev->value)
+		device->sw.state |= mask;
+	else
+		device->sw.state &= ~mask;
+	device->sw.state &= device->sw.available;
+}
+
+static void
+evdev_sync(struct libinput_device *device, uint64_t time)
+{
+	if (device->caps & bit(LIBINPUT_DEVICE_CAP_TABLET_PAD)) {
+		if (device->evdev.dropped)
+			pad_resync(device);
+		pad_flush_axes(device, time);
+		pad_flush_buttons(device, time);
+	} else if (device->caps & bit(LIBINPUT_DEVICE_CAP_TOUCH)) {
+		if (device->evdev.dropped)
+			touch_resync(device, time);
+		touch_flush(device, time);
+	} else if (device->pen.enabled) {
+		if (device->evdev.dropped)
+			pen_resync(device);
+		pen_flush(device);
+	}
+
+	if (device->caps & bit(LIBINPUT_DEVICE_CAP_SWITCH)) {
+		if (device->evdev.dropped)
+			switch_resync(device);
+		switch_flush(device, time);
+	}
+
+	device->evdev.dropped = false;
+}
+
+static void
+evdev_process(struct libinput_device *device, const struct input_event *ev)
+{
+	if (ev->type == EV_SYN) {
+		if (ev->code == SYN_DROPPED)
+			device->evdev.dropped = true;
+		else if (ev->code == SYN_REPORT)
+			evdev_sync(device, evdev_time(ev));
+		return;
+	}
+
+	/* Incomplete, the state is queried at the end of the frame */
+	if (device->evdev.dropped)
+		return;
+
+	if (ev->type == EV_SW)
+		switch_process(device, ev);
+	else if (device->caps & bit(LIBINPUT_DEVICE_CAP_TABLET_PAD))
+		pad_process(device, ev);
+	else if (device->caps & bit(LIBINPUT_DEVICE_CAP_TOUCH))
+		touch_process(device, ev);
+	else if (device->pen.enabled)
+		pen_process(device, ev);
+}
+
+void
+evdev_device_dispatch(void *data)
+{
+	struct libinput_device *device = data;
+	struct libinput *libinput = device->seat->libinput;
+	struct input_event ev[EVDEV_READ_RECORDS];
+	uint64_t trace_time;
+	ssize_t len;
+	int i, count;
+
+	trace_time = trace_begin(libinput);
+	len = read(device->fd, ev, sizeof(ev));
+	trace_end(libinput, TRACE_SPAN_READ, trace_time, device->fd);
+	if (len <= 0 || (len % sizeof(struct input_event)) != 0)
+		return;
+
+	count = len / sizeof(struct input_event);
+	device->stats.records += count;
+	device->read_now = libinput_now(libinput);
+	for (i = 0; i < count; i++)
+		evdev_process(device, &ev[i]);
+
+	device->last_time = evdev_time(&ev[count - 1]);
+}
+
+/* The device is about to be closed, release what is held on it */
+void
+evdev_device_release(struct libinput_device *device, uint64_t time)
+{
+	unsigned int i;
+
+	device->releasing = true;
+	if (device->caps & bit(LIBINPUT_DEVICE_CAP_TABLET_PAD)) {
+		device->pad.buttons = 0;
+		pad_flush_buttons(device, time);
+	}
+
+	if (device->caps & bit(LIBINPUT_DEVICE_CAP_TOUCH)) {
+		for (i = 0; i < device->touch.nslots; i++) {
+			device->touch.slots[i].tracking_id = -1;
+			device->touch.slots[i].dirty = true;
+		}
+		touch_flush(device, time);
+	}
+	device->releasing = false;
+
+	if (device->pen.enabled) {
+		device->pen.proximity = false;
+		pen_flush(device);
+	}
+
+	/* Nobody would notice the lid opening */
+	if (device->sw.lid_suspend)
+		wscons_seat_set_lid_closed(device->seat, false);
+}
+
+LIBINPUT_EXPORT int
+libinput_device_set_lid_suspend(struct libinput_device *device, int enable)
+{
+	if (!(device->sw.available & bit(LIBINPUT_SWITCH_LID)))
+		return -EINVAL;
+
+	device->sw.lid_suspend = enable != 0;
+	if (device->fd != -1)
+		wscons_seat_set_lid_closed(device->seat,
+					   device->sw.lid_suspend &&
+					   (device->sw.posted &
+					    bit(LIBINPUT_SWITCH_LID)));
+
+	return 0;
+}
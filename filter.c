@@ -0,0 +1,188 @@
+/*
+ * Copyright © 2026 libinput contributors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+/*
+ * Pointer acceleration. Motion arrives in the units of a 1000dpi mouse,
+ * touchpads were already scaled by their resolution, so velocities are
+ * tracked in mm/s for every device. The factor for a velocity is looked
+ * up in a per-device table, sampled from the curve of the device type
+ * and rebuilt only when the speed, the profile or the type changes.
+ */
+
+#include <math.h>
+#include <stdint.h>
+
+#include "libinput.h"
+#include "libinput-util.h"
+#include "libinput-private.h"
+
+/* Motion older than this does not count towards the velocity */
+#define ACCEL_TRACKER_TIMEOUT	ms2us(100)
+
+/* Velocity steps of the table, in mm/s */
+#define ACCEL_TABLE_STEP	8.0
+
+/* The lowest factor of the flat profile, it never stops the pointer */
+#define ACCEL_FLAT_MIN		0.005
+
+/*
+ * Mice: below the threshold motion is slowed down for precision, above
+ * it the factor grows with the velocity up to the maximum.
+ */
+static double
+accel_curve_mouse(double speed, double v)
+{
+	double threshold = 10 - 4 * speed;	/* mm/s */
+	double max_factor = 2 + speed;
+	double incline = 0.043;			/* per mm/s */
+
+	if (v <= threshold)
+		return min(1.0, 0.3 + v * 0.16);
+
+	return min(max_factor, 1 + (v - threshold) * incline);
+}
+
+/*
+ * Touchpads: fingers travel a short way, so the curve starts later and
+ * rises further than that of a mouse.
+ */
+static double
+accel_curve_touchpad(double speed, double v)
+{
+	double threshold = 40 - 15 * speed;	/* mm/s */
+	double max_factor = 3 + 1.5 * speed;
+	double incline = 0.025;			/* per mm/s */
+
+	if (v <= threshold)
+		return min(1.0, 0.4 + v * 0.03);
+
+	return min(max_factor, 1 + (v - threshold) * incline);
+}
+
+static void
+accel_build_table(struct libinput_device *device, enum accel_curve curve)
+{
+	double speed = device->accel.speed;
+	double v;
+	size_t i;
+
+	for (i = 0; i < ARRAY_LENGTH(device->accel.table); i++) {
+		v = i * ACCEL_TABLE_STEP;
+		if (device->accel.profile == LIBINPUT_CONFIG_ACCEL_PROFILE_FLAT)
+			device->accel.table[i] = max(ACCEL_FLAT_MIN, 1 + speed);
+		else if (curve == ACCEL_CURVE_TOUCHPAD)
+			device->accel.table[i] = accel_curve_touchpad(speed, v);
+		else
+			device->accel.table[i] = accel_curve_mouse(speed, v);
+	}
+
+	device->accel.curve = curve;
+	device->accel.dirty = false;
+}
+
+static double
+accel_lookup(struct libinput_device *device, double v)
+{
+	const double *table = device->accel.table;
+	size_t n = ARRAY_LENGTH(device->accel.table);
+	double pos = v / ACCEL_TABLE_STEP;
+	size_t i = pos;
+
+	if (i >= n - 1)
+		return table[n - 1];
+
+	return table[i] + (table[i + 1] - table[i]) * (pos - i);
+}
+
+/*
+ * Average velocity over the motion of the last ACCEL_TRACKER_TIMEOUT,
+ * each tracker covers the interval since the one before it.
+ */
+static double
+accel_velocity(struct libinput_device *device, uint64_t time)
+{
+	const struct accel_tracker *trackers = device->accel.trackers;
+	unsigned int n = ARRAY_LENGTH(device->accel.trackers);
+	unsigned int i, idx, prev;
+	double dist = 0;
+	uint64_t span = 0;
+
+	for (i = 0; i < n - 1; i++) {
+		idx = (device->accel.cur + n - i) % n;
+		prev = (idx + n - 1) % n;
+		if (trackers[prev].time == 0 ||
+		    trackers[prev].time >= trackers[idx].time ||
+		    time - trackers[prev].time > ACCEL_TRACKER_TIMEOUT)
+			break;
+
+		dist += trackers[idx].dist;
+		span = time - trackers[prev].time;
+	}
+
+	/* The first motion after a pause, spread it over the whole window */
+	if (span == 0) {
+		dist = trackers[device->accel.cur].dist;
+		span = ACCEL_TRACKER_TIMEOUT;
+	}
+
+	return dist * s2us(1) / span;
+}
+
+static enum accel_curve
+accel_device_curve(struct libinput_device *device)
+{
+	return device->tp.native ? ACCEL_CURVE_TOUCHPAD : ACCEL_CURVE_MOUSE;
+}
+
+/* Rebuild the table after a configuration change, not on the next motion */
+void
+filter_configure(struct libinput_device *device)
+{
+	if (device->accel.dirty)
+		accel_build_table(device, accel_device_curve(device));
+}
+
+void
+filter_dispatch(struct libinput_device *device,
+		const struct device_float_coords *delta,
+		uint64_t time,
+		struct normalized_coords *accel)
+{
+	enum accel_curve curve;
+	struct accel_tracker *tracker;
+	double factor;
+
+	curve = accel_device_curve(device);
+	if (device->accel.dirty || curve != device->accel.curve)
+		accel_build_table(device, curve);
+
+	device->accel.cur = (device->accel.cur + 1) %
+			    ARRAY_LENGTH(device->accel.trackers);
+	tracker = &device->accel.trackers[device->accel.cur];
+	tracker->dist = hypot(delta->x, delta->y) / MOTION_UNITS_PER_MM;
+	tracker->time = time;
+
+	factor = accel_lookup(device, accel_velocity(device, time));
+	accel->x = delta->x * factor;
+	accel->y = delta->y * factor;
+}
@@ -0,0 +1,360 @@
+/*
+ * Copyright © 2026 libinput contributors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+/*
+ * Keysyms. The kernel keymap of a keyboard is compiled into a flat table
+ * indexed by key code and level, so a lookup is a single array access.
+ * Tables are shared by all keyboards of a context with the same layout.
+ *
+ * With a cache directory set, compiled tables are also stored there and
+ * mapped read-only by every process using the same layout. A table is
+ * keyed by the wscons encoding and a checksum of the kernel keymap, so
+ * maps modified with wsconsctl(8) never pick up a stale table.
+ */
+
+#include <sys/types.h>
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <dev/wscons/wsconsio.h>
+#include <dev/wscons/wsksymdef.h>
+
+#include "libinput.h"
+#include "libinput-util.h"
+#include "libinput-private.h"
+
+extern uint32_t wskey_transcode(int);
+
+#define KEYMAP_MAGIC	0x4d4b494c	/* "LIKM" */
+#define KEYMAP_VERSION	1
+
+/* Levels: bit 0 is shift, bit 1 the second group (AltGr) */
+#define KEYMAP_LEVELS	4
+
+/* What a key does besides producing a keysym */
+#define KEYMAP_KEY_SHIFT	0x01
+#define KEYMAP_KEY_GROUP2	0x02
+#define KEYMAP_KEY_CAPSLOCK	0x04
+#define KEYMAP_KEY_LETTER	0x08	/* affected by caps lock */
+
+/* The layout shared through the cache directory, native byte order */
+struct keymap_table {
+	uint32_t magic;
+	uint32_t version;
+	uint32_t encoding;
+	uint32_t checksum;
+	uint32_t keysym[KEY_CNT][KEYMAP_LEVELS];
+	uint8_t flags[KEY_CNT];
+};
+
+struct keymap {
+	struct list link;
+	int refcount;
+	uint32_t encoding;
+	uint32_t checksum;
+	const struct keymap_table *table;
+	bool mapped;
+};
+
+static uint32_t
+keymap_checksum(const struct wscons_keymap *map, unsigned int len)
+{
+	const uint8_t *p = (const uint8_t *)map;
+	size_t i, size = len * sizeof(*map);
+	uint32_t hash = 2166136261u;	/* FNV-1a */
+
+	for (i = 0; i < size; i++) {
+		hash ^= p[i];
+		hash *= 16777619u;
+	}
+
+	return hash;
+}
+
+static bool
+keysym_is_letter(keysym_t ks)
+{
+	return (ks >= 'a' && ks <= 'z') ||
+	       (ks >= 0xe0 && ks <= 0xfe && ks != 0xf7);
+}
+
+static uint32_t
+keysym_or_zero(keysym_t ks)
+{
+	return ks == KS_voidSymbol ? 0 : ks;
+}
+
+static void
+keymap_compile(struct keymap_table *table,
+	       const struct wscons_keymap *map,
+	       unsigned int len)
+{
+	const struct wscons_keymap *ent;
+	uint32_t *levels;
+	unsigned int i;
+	uint32_t key;
+	keysym_t ks;
+
+	for (i = 0; i < len; i++) {
+		ent = &map[i];
+		key = wskey_transcode(i);
+		if (key == KEY_RESERVED || key == KEY_UNKNOWN || key >= KEY_CNT)
+			continue;
+
+		/* Missing symbols fall back to the first level and group */
+		levels = table->keysym[key];
+		levels[0] = keysym_or_zero(ent->group1[0]);
+		levels[1] = keysym_or_zero(ent->group1[1]);
+		if (levels[1] == 0)
+			levels[1] = levels[0];
+		levels[2] = keysym_or_zero(ent->group2[0]);
+		if (levels[2] == 0)
+			levels[2] = levels[0];
+		levels[3] = keysym_or_zero(ent->group2[1]);
+		if (levels[3] == 0)
+			levels[3] = ent->group2[0] == KS_voidSymbol ?
+				    levels[1] : levels[2];
+
+		ks = ent->group1[0];
+		if (ks == KS_Shift_L || ks == KS_Shift_R)
+			table->flags[key] |= KEYMAP_KEY_SHIFT;
+		else if (ks == KS_Mode_switch)
+			table->flags[key] |= KEYMAP_KEY_GROUP2;
+		else if (ks == KS_Caps_Lock)
+			table->flags[key] |= KEYMAP_KEY_CAPSLOCK;
+		else if (keysym_is_letter(ks))
+			table->flags[key] |= KEYMAP_KEY_LETTER;
+	}
+}
+
+static const struct keymap_table *
+keymap_cache_map(const char *path, uint32_t encoding, uint32_t checksum)
+{
+	const struct keymap_table *table;
+	struct stat st;
+	int fd;
+
+	fd = open(path, O_RDONLY | O_CLOEXEC);
+	if (fd == -1)
+		return NULL;
+
+	if (fstat(fd, &st) == -1 || st.st_size != sizeof(*table)) {
+		close(fd);
+		return NULL;
+	}
+
+	table = mmap(NULL, sizeof(*table), PROT_READ, MAP_SHARED, fd, 0);
+	close(fd);
+	if (table == MAP_FAILED)
+		return NULL;
+
+	if (table->magic != KEYMAP_MAGIC ||
+	    table->version != KEYMAP_VERSION ||
+	    table->encoding != encoding ||
+	    table->checksum != checksum) {
+		munmap((void *)table, sizeof(*table));
+		return NULL;
+	}
+
+	return table;
+}
+
+/* Write the table under a temporary name so readers never see it partly */
+static void
+keymap_cache_store(struct libinput *libinput,
+		   const char *path,
+		   const struct keymap_table *table)
+{
+	char tmp[PATH_MAX];
+	int fd;
+
+	if (snprintf(tmp, sizeof(tmp), "%s.XXXXXX", path) >= (int)sizeof(tmp))
+		return;
+
+	fd = mkstemp(tmp);
+	if (fd == -1) {
+		log_info(libinput, "keymap: cannot create %s (%s)\n", tmp,
+			 strerror(errno));
+		return;
+	}
+
+	if (write(fd, table, sizeof(*table)) != sizeof(*table) ||
+	    fchmod(fd, 0644) == -1 ||
+	    rename(tmp, path) == -1) {
+		log_info(libinput, "keymap: cannot store %s (%s)\n", path,
+			 strerror(errno));
+		unlink(tmp);
+	}
+
+	close(fd);
+}
+
+static struct keymap *
+keymap_create(struct libinput *libinput,
+	      uint32_t encoding,
+	      uint32_t checksum,
+	      const struct wscons_keymap *map,
+	      unsigned int len)
+{
+	struct keymap *keymap;
+	struct keymap_table *table;
+	char path[PATH_MAX];
+	bool cached = false;
+
+	keymap = zalloc(sizeof(*keymap));
+	if (keymap == NULL)
+		return NULL;
+
+	keymap->refcount = 1;
+	keymap->encoding = encoding;
+	keymap->checksum = checksum;
+
+	if (libinput->keymap_cache_dir != NULL &&
+	    snprintf(path, sizeof(path), "%s/keymap-%08x-%08x",
+		     libinput->keymap_cache_dir, encoding, checksum) <
+	    (int)sizeof(path)) {
+		cached = true;
+		keymap->table = keymap_cache_map(path, encoding, checksum);
+		keymap->mapped = keymap->table != NULL;
+	}
+
+	if (keymap->table == NULL) {
+		table = zalloc(sizeof(*table));
+		if (table == NULL) {
+			free(keymap);
+			return NULL;
+		}
+
+		table->magic = KEYMAP_MAGIC;
+		table->version = KEYMAP_VERSION;
+		table->encoding = encoding;
+		table->checksum = checksum;
+		keymap_compile(table, map, len);
+		if (cached)
+			keymap_cache_store(libinput, path, table);
+
+		keymap->table = table;
+	}
+
+	list_insert(&libinput->keymap_list, &keymap->link);
+
+	return keymap;
+}
+
+struct keymap *
+keymap_get(struct libinput *libinput, int fd)
+{
+	struct wscons_keymap map[WSKBDIO_MAXMAPLEN];
+	struct wskbd_map_data data;
+	struct keymap *keymap;
+	uint32_t checksum;
+	kbd_t encoding;
+
+	data.maplen = ARRAY_LENGTH(map);
+	data.map = map;
+	if (ioctl(fd, WSKBDIO_GETENCODING, &encoding) == -1 ||
+	    ioctl(fd, WSKBDIO_GETMAP, &data) == -1)
+		return NULL;
+
+	checksum = keymap_checksum(map, data.maplen);
+
+	list_for_each(keymap, &libinput->keymap_list, link) {
+		if (keymap->encoding == encoding &&
+		    keymap->checksum == checksum) {
+			keymap->refcount++;
+			return keymap;
+		}
+	}
+
+	return keymap_create(libinput, encoding, checksum, map, data.maplen);
+}
+
+void
+keymap_unref(struct keymap *keymap)
+{
+	if (keymap == NULL || --keymap->refcount > 0)
+		return;
+
+	list_remove(&keymap->link);
+	if (keymap->mapped)
+		munmap((void *)keymap->table, sizeof(*keymap->table));
+	else
+		free((void *)keymap->table);
+	free(keymap);
+}
+
+uint32_t
+keymap_process_key(struct libinput_device *device,
+		   uint32_t key,
+		   enum libinput_key_state state)
+{
+	const struct keymap_table *table;
+	struct keymap_state *ks = &device->keymap_state;
+	bool pressed = state == LIBINPUT_KEY_STATE_PRESSED;
+	unsigned int level = 0;
+	uint8_t flags;
+
+	if (device->keymap == NULL || key >= KEY_CNT)
+		return 0;
+
+	table = device->keymap->table;
+	flags = table->flags[key];
+
+	if (flags & KEYMAP_KEY_SHIFT)
+		ks->shift += pressed ? 1 : (ks->shift > 0 ? -1 : 0);
+	else if (flags & KEYMAP_KEY_GROUP2)
+		ks->group2 += pressed ? 1 : (ks->group2 > 0 ? -1 : 0);
+	else if ((flags & KEYMAP_KEY_CAPSLOCK) && pressed)
+		ks->capslock = !ks->capslock;
+
+	if ((ks->shift > 0) != (ks->capslock && (flags & KEYMAP_KEY_LETTER)))
+		level |= 0x1;
+	if (ks->group2 > 0)
+		level |= 0x2;
+
+	return table->keysym[key][level];
+}
+
+LIBINPUT_EXPORT int
+libinput_set_keymap_cache_dir(struct libinput *libinput, const char *path)
+{
+	char *dir = NULL;
+
+	if (path != NULL && (dir = strdup(path)) == NULL)
+		return -ENOMEM;
+
+	free(libinput->keymap_cache_dir);
+	libinput->keymap_cache_dir = dir;
+
+	return 0;
+}
@@ -28,7 +28,16 @@
 #include "libinput.h"
 #include "linux/input.h"
 
+struct busypoll;
+struct flight_recorder;
+struct keymap;
 struct libinput_source;
+struct libinput_trace;
+struct wscons_event;
+union libinput_event_block;
+
+/* Relative motion units per mm, those of a 1000dpi mouse */
+#define MOTION_UNITS_PER_MM	(1000 / 25.4)
 
 /* A coordinate pair in device coordinates */
 struct device_coords {
@@ -58,6 +67,14 @@ struct wheel_v120 {
 	int x, y;
 };
 
+struct libinput_timer {
+	struct libinput *libinput;
+	struct list link;
+	uint64_t expire;	/* in absolute us of the context clock */
+	void (*timer_func)(uint64_t now, void *timer_func_data);
+	void *timer_func_data;
+};
+
 struct libinput {
 	int kq;
 	struct list source_destroy_list;
@@ -70,12 +87,35 @@ struct libinput {
 	size_t events_in;
 	size_t events_out;
 
+	/* released events, recycled by libinput_event_alloc() */
+	struct {
+		union libinput_event_block *free;
+		unsigned int count;
+	} event_pool;
+
 	const struct libinput_interface *interface;
 
 	libinput_log_handler log_handler;
 	enum libinput_log_priority log_priority;
 	void *user_data;
 	int refcount;
+
+	const struct libinput_clock_interface *clock;
+	void *clock_data;
+
+	struct {
+		struct list list;
+		uint64_t next_expiry;	/* 0 if the kqueue timer is unarmed */
+	} timer;
+
+	struct libinput_trace *trace;
+	unsigned int recorder_size;	/* records per device, 0 if disabled */
+
+	char *keymap_cache_dir;		/* NULL if keymaps are not cached */
+	struct list keymap_list;	/* keymaps in use by keyboards */
+	struct list device_group_list;
+
+	struct busypoll *busypoll;	/* NULL unless busy-polling */
 };
 
 struct libinput_seat {
@@ -89,9 +129,113 @@ struct libinput_seat {
 	char *logical_name;
 
 	uint32_t button_count[KEY_CNT];
+	uint32_t slot_map;		/* seat slots of the touches down */
+	bool lid_closed;		/* internal devices are suspended */
+
+	struct {
+		uint64_t last_activity;	/* libinput_now() of the last input */
+		uint64_t timeout;	/* 0 if no idle handler is set */
+		bool idle;		/* the handler was told the seat is idle */
+		struct libinput_timer timer;
+		libinput_seat_idle_handler handler;
+		void *user_data;
+	} idle;
 };
 
 struct libinput_device_group {
+	int refcount;
+	void *user_data;
+	char *identifier;		/* NULL for a device on its own */
+	struct list link;		/* in libinput->device_group_list */
+	struct list devices;		/* the devices of the group */
+	struct libinput_device *pen;	/* in proximity, NULL if none */
+};
+
+/* Modifiers of a keyboard, as far as they select the keysym level */
+struct keymap_state {
+	int shift;			/* number of shift keys held */
+	int group2;			/* number of group switch keys held */
+	bool capslock;
+};
+
+enum tp_hold_state {
+	TP_HOLD_NONE,
+	TP_HOLD_PENDING,	/* fingers down, waiting for the timeout */
+	TP_HOLD_ACTIVE,		/* hold begin was posted */
+};
+
+enum tp_edge {
+	TP_EDGE_NONE,
+	TP_EDGE_RIGHT,
+	TP_EDGE_BOTTOM,
+};
+
+/* the primary contact of a touchpad in native mode */
+struct tp_touch {
+	bool down;
+	struct device_coords point;	/* as of the latest records */
+	struct device_coords last;	/* as of the previous frame */
+	enum tp_edge edge;		/* where the touch went down */
+};
+
+enum accel_curve {
+	ACCEL_CURVE_MOUSE,
+	ACCEL_CURVE_TOUCHPAD,
+};
+
+/* the motion of one frame, for the velocity */
+struct accel_tracker {
+	double dist;			/* mm */
+	uint64_t time;
+};
+
+/* settings a configuration transaction can stage */
+enum config_field {
+	CONFIG_ACCEL_SPEED,
+	CONFIG_ACCEL_PROFILE,
+	CONFIG_ROTATION,
+	CONFIG_SCROLL_METHOD,
+	CONFIG_SEND_EVENTS,
+	CONFIG_ABS_TO_REL,
+};
+
+#define PAD_MAX_BUTTONS		32
+#define PAD_MAX_RINGS		2
+#define PAD_MAX_STRIPS		2
+
+/* the buttons, rings and strips of a tablet pad switching modes together */
+struct libinput_tablet_pad_mode_group {
+	struct libinput_device *device;
+	unsigned int index;
+	int refcount;			/* held by the caller, not the pad */
+	void *user_data;
+	unsigned int num_modes;
+	unsigned int mode;
+	uint32_t buttons;		/* bitmasks of the members */
+	uint32_t rings;
+	uint32_t strips;
+	uint32_t toggles;		/* buttons switching to the next mode */
+};
+
+#define TOUCH_MAX_SLOTS		16
+
+/* a contact of a touchscreen */
+struct touch_slot {
+	int tracking_id;		/* -1 if no contact */
+	bool dirty;			/* changed by the latest records */
+	bool down;			/* touch down was posted */
+	bool suppressed;		/* under the pen, never posted */
+	int seat_slot;
+	struct device_coords point;
+};
+
+/* a ring or strip of a tablet pad */
+struct pad_axis {
+	int code;			/* ABS_* */
+	int minimum;
+	int maximum;
+	int value;			/* as of the latest records */
+	int posted;			/* as of the last event */
 };
 
 struct libinput_device {
@@ -100,18 +244,264 @@ struct libinput_device {
 	void *user_data;
 	int refcount;
 
+	struct libinput_device_group *group;	/* never NULL */
+	struct list group_link;
+
 	struct libinput_source *source;
 	char *devname;
 	int fd;
+
+	uint32_t caps;			/* bitmask of libinput_device_capability */
+	unsigned int wstype;		/* WSKBD_TYPE_* or WSMOUSE_TYPE_* */
+	struct libinput_timer open_timer;
+
+	/* read through evdev(4) instead of wscons, see evdev.c */
+	struct {
+		bool enabled;
+		bool dropped;		/* discard records until SYN_REPORT */
+	} evdev;
+
+	/* absolute axis range and resolution (units/mm), probed on open */
+	struct {
+		bool valid;
+		struct device_coords min;
+		struct device_coords max;
+		struct device_coords res;
+	} abs;
+
+	/* keys and buttons currently held down on this device */
+	unsigned long key_mask[NLONGS(KEY_CNT)];
+
+	uint64_t last_time;		/* timestamp of the last record read */
+	uint64_t read_now;		/* libinput_now() of the latest read */
+
+	struct flight_recorder *recorder;	/* NULL if disabled */
+	int busypoll_slot;		/* -1 unless read by busy-polling */
+
+	struct keymap *keymap;		/* NULL if not a keyboard */
+	struct keymap_state keymap_state;
+
+	uint32_t sendevents_mode;	/* libinput_config_send_events_mode */
+	bool suspended;			/* closed and out of the event loop */
+	bool releasing;			/* posting releases, not input */
+
+	/* relative motion accumulated until the end of the frame */
+	struct {
+		bool pending;
+		uint64_t time;
+		struct device_float_coords delta;
+	} motion;
+
+	/* absolute positions converted into relative motion, per axis */
+	struct {
+		bool enabled;
+		bool valid[2];		/* false until a reference position */
+		int last[2];
+	} abs_to_rel;
+
+	/* token bucket, one token is TOKEN_SCALE units */
+	struct {
+		unsigned int rate;	/* tokens per second, 0 if unlimited */
+		unsigned int burst;
+		uint64_t tokens;
+		uint64_t last;		/* time of the last refill */
+		struct ratelimit log_limit;
+	} limit;
+
+	struct libinput_device_stats stats;
+
+	/* if set, relative motion bypasses the event queue */
+	struct {
+		libinput_raw_motion_handler handler;
+		void *user_data;
+	} raw;
+
+	/* the matrix is only valid, and only applied, if angle != 0 */
+	struct {
+		unsigned int angle;
+		struct matrix matrix;
+	} rotation;
+
+	/* touchpad scrolling, see touchpad.c */
+	struct {
+		enum libinput_config_scroll_method method;
+		bool native;		/* WSMOUSE_NATIVE mode is set */
+		unsigned int fingers;	/* contacts in the current frame */
+		unsigned int last_fingers;
+		bool reset;		/* the position history was lost */
+		struct tp_touch touch;
+		struct {
+			bool active;
+			uint32_t axes;	/* locked axes, 0 until decided */
+			struct normalized_coords travel; /* held back */
+		} scroll;
+		struct {
+			enum tp_hold_state state;
+			unsigned int fingers;
+			uint64_t start;		/* record time of the touch */
+			double travel;		/* mm since the touch */
+			struct libinput_timer timer;
+		} hold;
+	} tp;
+
+	/* pointer acceleration, see filter.c */
+	struct {
+		double speed;		/* [-1, 1] */
+		enum libinput_config_accel_profile profile;
+		enum accel_curve curve;	/* the table was built for */
+		bool dirty;		/* the table needs a rebuild */
+		double table[128];	/* factor per velocity step */
+		struct accel_tracker trackers[16];
+		unsigned int cur;	/* the newest tracker */
+	} accel;
+
+	/* settings staged until the transaction is committed */
+	struct {
+		bool open;
+		uint32_t staged;	/* bitmask of enum config_field */
+		double accel_speed;
+		enum libinput_config_accel_profile accel_profile;
+		unsigned int rotation;
+		enum libinput_config_scroll_method scroll_method;
+		uint32_t sendevents_mode;
+		bool abs_to_rel;
+	} txn;
+
+	/* wheel acceleration, see wheel.c */
+	struct {
+		bool enabled;
+		uint64_t clicks[8];	/* record times of the latest clicks */
+		unsigned int cur;	/* the newest click */
+		int direction;		/* of the latest clicks, 0 if none */
+		int pending;		/* clicks held back */
+		double delta;		/* their accelerated scroll value */
+		uint64_t time;		/* of the newest click held back */
+		struct libinput_timer timer;
+	} wheel;
+
+	/* tablet pad, see evdev.c */
+	struct {
+		unsigned int nbuttons;
+		unsigned int nrings;
+		unsigned int nstrips;
+		uint16_t codes[PAD_MAX_BUTTONS];	/* BTN_* per button */
+		uint32_t buttons;	/* held as of the latest records */
+		uint32_t posted;	/* held as of the last event */
+		bool terminator;	/* ABS_MISC 0, the finger lifted */
+		struct pad_axis rings[PAD_MAX_RINGS];
+		struct pad_axis strips[PAD_MAX_STRIPS];
+		struct libinput_tablet_pad_mode_group group;
+	} pad;
+
+	/* touchscreen, see evdev.c */
+	struct {
+		unsigned int nslots;
+		int slot;		/* the slot ABS_MT_* records refer to */
+		struct touch_slot slots[TOUCH_MAX_SLOTS];
+	} touch;
+
+	/* lid and tablet mode switches, bitmasks of libinput_switch */
+	struct {
+		uint32_t available;
+		uint32_t state;		/* as of the latest records */
+		uint32_t posted;	/* as of the last event */
+		bool lid_suspend;	/* a closed lid suspends the seat */
+	} sw;
+
+	/* pen, only tracked to suppress touches under it, see evdev.c */
+	struct {
+		bool enabled;
+		bool proximity;		/* as of the latest records */
+		struct device_coords point;
+	} pen;
 };
 
 struct libinput_event {
 	enum libinput_event_type type;
 	struct libinput_device *device;
+	int refcount;
 };
 
 typedef void (*libinput_source_dispatch_t)(void *data);
 
+enum trace_span {
+	TRACE_SPAN_DISPATCH,
+	TRACE_SPAN_READ,
+	TRACE_SPAN_DECODE,
+	TRACE_SPAN_FRAME,
+	TRACE_SPAN_POST,
+	TRACE_SPAN_DEQUEUE,
+};
+
+struct keymap *
+keymap_get(struct libinput *libinput, int fd);
+
+void
+keymap_unref(struct keymap *keymap);
+
+uint32_t
+keymap_process_key(struct libinput_device *device,
+		   uint32_t key,
+		   enum libinput_key_state state);
+
+struct flight_recorder *
+flight_recorder_create(unsigned int size);
+
+void
+flight_recorder_destroy(struct flight_recorder *recorder);
+
+void
+flight_recorder_append(struct flight_recorder *recorder,
+		       const struct wscons_event *records,
+		       unsigned int count);
+
+void
+busypoll_drain(struct libinput *libinput);
+
+int
+busypoll_add(struct libinput *libinput, struct libinput_device *device);
+
+void
+busypoll_remove(struct libinput *libinput, struct libinput_device *device);
+
+void
+busypoll_destroy(struct libinput *libinput);
+
+uint64_t
+trace_now(void);
+
+void
+trace_record(struct libinput_trace *trace,
+	     enum trace_span span,
+	     uint64_t begin,
+	     uint64_t end,
+	     uint32_t arg);
+
+/*
+ * Returns the start timestamp of a span, or 0 if tracing is disabled.
+ * The result is passed to trace_end() once the traced work completes.
+ */
+static inline uint64_t
+trace_begin(struct libinput *libinput)
+{
+	if (libinput->trace == NULL)
+		return 0;
+
+	return trace_now();
+}
+
+static inline void
+trace_end(struct libinput *libinput,
+	  enum trace_span span,
+	  uint64_t begin,
+	  uint32_t arg)
+{
+	if (begin == 0 || libinput->trace == NULL)
+		return;
+
+	trace_record(libinput->trace, span, begin, trace_now(), arg);
+}
+
 #define log_debug(li_, ...) log_msg((li_), LIBINPUT_LOG_PRIORITY_DEBUG, __VA_ARGS__)
 #define log_info(li_, ...) log_msg((li_), LIBINPUT_LOG_PRIORITY_INFO, __VA_ARGS__)
 #define log_error(li_, ...) log_msg((li_), LIBINPUT_LOG_PRIORITY_ERROR, __VA_ARGS__)
@@ -146,6 +536,46 @@ log_msg_va(struct libinput *libinput,
 	   va_list args)
 	LIBINPUT_ATTRIBUTE_PRINTF(3, 0);
 
+uint64_t
+libinput_now(struct libinput *libinput);
+
+void
+seat_idle_end(struct libinput_seat *seat);
+
+/*
+ * Note input on the seat of the device at the time it was read. Unless
+ * the seat was reported idle, this is a single store, the idle timer
+ * catches up with it when it expires. Releases posted for a device being
+ * suspended or resynced are no input.
+ */
+static inline void
+device_notify_activity(struct libinput_device *device)
+{
+	struct libinput_seat *seat = device->seat;
+
+	if (device->releasing)
+		return;
+
+	seat->idle.last_activity = device->read_now;
+	if (seat->idle.idle)
+		seat_idle_end(seat);
+}
+
+void
+libinput_timer_init(struct libinput_timer *timer,
+		    struct libinput *libinput,
+		    void (*timer_func)(uint64_t now, void *timer_func_data),
+		    void *timer_func_data);
+
+void
+libinput_timer_set(struct libinput_timer *timer, uint64_t expire);
+
+void
+libinput_timer_cancel(struct libinput_timer *timer);
+
+void
+libinput_timer_handler(struct libinput *libinput);
+
 int
 libinput_init(struct libinput *libinput,
 	      const struct libinput_interface *interface,
@@ -172,6 +602,57 @@ void
 libinput_device_init(struct libinput_device *device,
 		     struct libinput_seat *seat);
 
+struct libinput_device_group *
+libinput_device_group_create(struct libinput *libinput,
+			     const char *identifier);
+
+struct libinput_device_group *
+libinput_device_group_find_group(struct libinput *libinput,
+				 const char *identifier);
+
+void
+libinput_device_set_device_group(struct libinput_device *device,
+				 struct libinput_device_group *group);
+
+bool
+wscons_device_is_touchpad(struct libinput_device *device);
+
+void
+wscons_device_update_send_events(struct libinput_device *device);
+
+void
+wscons_seat_set_lid_closed(struct libinput_seat *seat, bool closed);
+
+int
+wscons_device_listen(struct libinput_device *device);
+
+void
+wscons_device_unlisten(struct libinput_device *device);
+
+void
+wscons_device_process(struct libinput_device *device,
+		      struct wscons_event *wsevents,
+		      int count,
+		      uint64_t read_time);
+
+bool
+evdev_is_device_path(const char *path);
+
+void
+evdev_device_probe(struct libinput_device *device);
+
+bool
+evdev_device_group_id(struct libinput_device *device, char *id, size_t len);
+
+void
+evdev_device_dispatch(void *data);
+
+void
+evdev_device_release(struct libinput_device *device, uint64_t time);
+
+void *
+libinput_event_alloc(struct libinput *libinput);
+
 void
 keyboard_notify_key(struct libinput_device *device,
 		    uint64_t time,
@@ -184,6 +665,62 @@ axis_notify_event(struct libinput_device *device,
     const struct normalized_coords *delta,
     const struct device_float_coords *raw);
 
+void
+filter_dispatch(struct libinput_device *device,
+		const struct device_float_coords *delta,
+		uint64_t time,
+		struct normalized_coords *accel);
+
+void
+filter_configure(struct libinput_device *device);
+
+void
+tp_init(struct libinput_device *device);
+
+void
+tp_process_frame(struct libinput_device *device, uint64_t time);
+
+void
+tp_release(struct libinput_device *device, uint64_t time);
+
+void
+tp_update_mode(struct libinput_device *device);
+
+void
+wheel_init(struct libinput_device *device);
+
+void
+wheel_process(struct libinput_device *device, uint64_t time, int value);
+
+void
+wheel_flush(struct libinput_device *device);
+
+void
+wheel_release(struct libinput_device *device);
+
+void
+gesture_notify_hold(struct libinput_device *device,
+		    uint64_t time,
+		    int finger_count);
+
+void
+gesture_notify_hold_end(struct libinput_device *device,
+			uint64_t time,
+			int finger_count,
+			bool cancelled);
+
+void
+pointer_notify_scroll_finger(struct libinput_device *device,
+			     uint64_t time,
+			     uint32_t axes,
+			     const struct normalized_coords *delta);
+
+void
+pointer_notify_scroll_wheel(struct libinput_device *device,
+			    uint64_t time,
+			    const struct normalized_coords *delta,
+			    const struct wheel_v120 *v120);
+
 void
 pointer_notify_motion(struct libinput_device *device,
 		      uint64_t time,
@@ -196,6 +733,64 @@ pointer_notify_button(struct libinput_device *device,
 		      int32_t button,
 		      enum libinput_button_state state);
 
+void
+tablet_pad_notify_button(struct libinput_device *device,
+			 uint64_t time,
+			 int32_t button,
+			 enum libinput_button_state state,
+			 struct libinput_tablet_pad_mode_group *group);
+
+void
+tablet_pad_notify_ring(struct libinput_device *device,
+		       uint64_t time,
+		       unsigned int number,
+		       double value,
+		       enum libinput_tablet_pad_ring_axis_source source,
+		       struct libinput_tablet_pad_mode_group *group);
+
+void
+tablet_pad_notify_strip(struct libinput_device *device,
+			uint64_t time,
+			unsigned int number,
+			double value,
+			enum libinput_tablet_pad_strip_axis_source source,
+			struct libinput_tablet_pad_mode_group *group);
+
+void
+touch_notify_touch_down(struct libinput_device *device,
+			uint64_t time,
+			int32_t slot,
+			int32_t seat_slot,
+			const struct device_coords *point);
+
+void
+touch_notify_touch_motion(struct libinput_device *device,
+			  uint64_t time,
+			  int32_t slot,
+			  int32_t seat_slot,
+			  const struct device_coords *point);
+
+void
+touch_notify_touch_up(struct libinput_device *device,
+		      uint64_t time,
+		      int32_t slot,
+		      int32_t seat_slot);
+
+void
+touch_notify_touch_cancel(struct libinput_device *device,
+			  uint64_t time,
+			  int32_t slot,
+			  int32_t seat_slot);
+
+void
+touch_notify_frame(struct libinput_device *device, uint64_t time);
+
+void
+switch_notify_toggle(struct libinput_device *device,
+		     uint64_t time,
+		     enum libinput_switch sw,
+		     enum libinput_switch_state state);
+
 void
 post_device_event(struct libinput_device *device,
 		  uint64_t time,
@@ -83,7 +83,7 @@ list_empty(const struct list *list)
 
  * the exact state. It evaluates to "true" if the threshold hasn't been
 
- * exceeded, yet.
+ * exceeded, yet. The current time is passed in by the caller, in us.
 
  *
 
@@ -97,21 +97,25 @@ list_empty(const struct list *list)
 
  */
 
+void
+ratelimit_init(struct ratelimit *r, uint64_t ival_ms, unsigned int burst)
+{
+	r->interval = ms2us(ival_ms);
+	r->begin = 0;
+	r->burst = burst;
+	r->num = 0;
+}
+
 enum ratelimit_state
-ratelimit_test(struct ratelimit *r)
+ratelimit_test(struct ratelimit *r, uint64_t now)
 
 {
-	struct timespec ts;
-	uint64_t utime;
 	if (r->interval <= 0 || r->burst <= 0)
 		return RATELIMIT_PASS;
 
-	clock_gettime(CLOCK_MONOTONIC, &ts);
-	utime = s2us(ts.tv_sec) + ns2us(ts.tv_nsec);
-
-	if (r->begin <= 0 || r->begin + r->interval < utime) {
+	if (r->begin <= 0 || r->begin + r->interval < now) {
 		/* reset counter */
-		r->begin = utime;
+		r->begin = now;
 		r->num = 1;
 		return RATELIMIT_PASS;
 	}
@@ -195,6 +195,21 @@ matrix_init_translate(struct matrix *m, float x, float y)
 	m->val[1][2] = y;
 }
 
+static inline void
+matrix_init_rotate(struct matrix *m, int degrees)
+{
+	double s, c;
+
+	s = sin(degrees * M_PI / 180);
+	c = cos(degrees * M_PI / 180);
+
+	matrix_init_identity(m);
+	m->val[0][0] = c;
+	m->val[0][1] = -s;
+	m->val[1][0] = s;
+	m->val[1][1] = c;
+}
+
 static inline int
 matrix_is_identity(struct matrix *m)
 {
@@ -242,6 +257,18 @@ matrix_mult_vec(struct matrix *m, int *x, int *y)
 	*y = ty;
 }
 
+static inline void
+matrix_mult_vec_double(const struct matrix *m, double *x, double *y)
+{
+	double tx, ty;
+
+	tx = *x * m->val[0][0] + *y * m->val[0][1] + m->val[0][2];
+	ty = *x * m->val[1][0] + *y * m->val[1][1] + m->val[1][2];
+
+	*x = tx;
+	*y = ty;
+}
+
 static inline void
 matrix_to_farray6(const struct matrix *m, float out[6])
 {
@@ -299,7 +326,7 @@ struct ratelimit {
 };
 
 void ratelimit_init(struct ratelimit *r, uint64_t ival_ms, unsigned int burst);
-enum ratelimit_state ratelimit_test(struct ratelimit *r);
+enum ratelimit_state ratelimit_test(struct ratelimit *r, uint64_t now);
 
 int parse_mouse_dpi_property(const char *prop);
 int parse_mouse_wheel_click_angle_property(const char *prop);
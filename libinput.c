@@ -29,6 +29,7 @@
 #include <assert.h>
 #include <errno.h>
 #include <stdarg.h>
+#include <stddef.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <stdint.h>
@@ -90,6 +91,7 @@ struct libinput_event_keyboard {
 	uint32_t key;
 	uint32_t seat_key_count;
 	enum libinput_key_state state;
+	uint32_t keysym;
 };
 
 struct libinput_event_pointer {
@@ -126,6 +128,95 @@ struct libinput_event_gesture {
 	double angle;
 };
 
+struct libinput_event_tablet_pad {
+	struct libinput_event base;
+	uint64_t time;
+	unsigned int mode;
+	struct libinput_tablet_pad_mode_group *mode_group;
+	struct {
+		uint32_t number;
+		enum libinput_button_state state;
+	} button;
+	struct {
+		uint32_t code;
+		enum libinput_key_state state;
+	} key;
+	struct {
+		enum libinput_tablet_pad_ring_axis_source source;
+		double position;
+		int number;
+	} ring;
+	struct {
+		enum libinput_tablet_pad_strip_axis_source source;
+		double position;
+		int number;
+	} strip;
+};
+
+struct libinput_event_switch {
+	struct libinput_event base;
+	uint64_t time;
+	enum libinput_switch sw;
+	enum libinput_switch_state state;
+};
+
+/* Events are recycled through blocks large enough for any event type */
+#define EVENT_POOL_MAX	256
+
+union libinput_event_block {
+	union libinput_event_block *next;	/* while in the pool */
+	struct libinput_event_device_notify device_notify;
+	struct libinput_event_keyboard keyboard;
+	struct libinput_event_pointer pointer;
+	struct libinput_event_touch touch;
+	struct libinput_event_gesture gesture;
+	struct libinput_event_tablet_pad tablet_pad;
+	struct libinput_event_switch sw;
+};
+
+void *
+libinput_event_alloc(struct libinput *libinput)
+{
+	union libinput_event_block *block = libinput->event_pool.free;
+
+	if (block == NULL)
+		return zalloc(sizeof(*block));
+
+	libinput->event_pool.free = block->next;
+	libinput->event_pool.count--;
+	memset(block, 0, sizeof(*block));
+
+	return block;
+}
+
+static void
+libinput_event_release(struct libinput *libinput,
+		       struct libinput_event *event)
+{
+	union libinput_event_block *block = (union libinput_event_block *)event;
+
+	if (libinput == NULL || libinput->event_pool.count >= EVENT_POOL_MAX) {
+		free(block);
+		return;
+	}
+
+	block->next = libinput->event_pool.free;
+	libinput->event_pool.free = block;
+	libinput->event_pool.count++;
+}
+
+static void
+libinput_event_pool_drain(struct libinput *libinput)
+{
+	union libinput_event_block *block;
+
+	while ((block = libinput->event_pool.free) != NULL) {
+		libinput->event_pool.free = block->next;
+		free(block);
+	}
+	libinput->event_pool.count = 0;
+}
+
 static void
 libinput_default_log_func(struct libinput *libinput,
 			  enum libinput_log_priority priority,
@@ -176,7 +267,7 @@ log_msg_ratelimit(struct libinput *libinput,
 	va_list args;
 	enum ratelimit_state state;
 
-	state = ratelimit_test(ratelimit);
+	state = ratelimit_test(ratelimit, libinput_now(libinput));
 	if (state == RATELIMIT_EXCEEDED)
 		return;
 
@@ -244,6 +335,7 @@ libinput_event_get_pointer_event(struct libinput_event *event)
 			   LIBINPUT_EVENT_POINTER_MOTION_ABSOLUTE,
 			   LIBINPUT_EVENT_POINTER_BUTTON,
 			   LIBINPUT_EVENT_POINTER_SCROLL_WHEEL,
+			   LIBINPUT_EVENT_POINTER_SCROLL_FINGER,
 			   LIBINPUT_EVENT_POINTER_AXIS);
 
 	return (struct libinput_event_pointer *) event;
@@ -286,11 +378,38 @@ libinput_event_get_gesture_event(struct libinput_event *event)
 			   LIBINPUT_EVENT_GESTURE_SWIPE_END,
 			   LIBINPUT_EVENT_GESTURE_PINCH_BEGIN,
 			   LIBINPUT_EVENT_GESTURE_PINCH_UPDATE,
-			   LIBINPUT_EVENT_GESTURE_PINCH_END);
+			   LIBINPUT_EVENT_GESTURE_PINCH_END,
+			   LIBINPUT_EVENT_GESTURE_HOLD_BEGIN,
+			   LIBINPUT_EVENT_GESTURE_HOLD_END);
 
 	return (struct libinput_event_gesture *) event;
 }
 
+LIBINPUT_EXPORT struct libinput_event_tablet_pad *
+libinput_event_get_tablet_pad_event(struct libinput_event *event)
+{
+	require_event_type(libinput_event_get_context(event),
+			   event->type,
+			   NULL,
+			   LIBINPUT_EVENT_TABLET_PAD_RING,
+			   LIBINPUT_EVENT_TABLET_PAD_STRIP,
+			   LIBINPUT_EVENT_TABLET_PAD_BUTTON,
+			   LIBINPUT_EVENT_TABLET_PAD_KEY);
+
+	return (struct libinput_event_tablet_pad *) event;
+}
+
+LIBINPUT_EXPORT struct libinput_event_switch *
+libinput_event_get_switch_event(struct libinput_event *event)
+{
+	require_event_type(libinput_event_get_context(event),
+			   event->type,
+			   NULL,
+			   LIBINPUT_EVENT_SWITCH_TOGGLE);
+
+	return (struct libinput_event_switch *) event;
+}
+
 LIBINPUT_EXPORT struct libinput_event_device_notify *
 libinput_event_get_device_notify_event(struct libinput_event *event)
 {
@@ -303,6 +422,104 @@ libinput_event_get_device_notify_event(struct libinput_event *event)
 	return (struct libinput_event_device_notify *) event;
 }
 
+LIBINPUT_EXPORT int
+libinput_event_get_record(struct libinput_event *event,
+			  struct libinput_event_record *record,
+			  size_t size)
+{
+	struct libinput_event_record rec;
+	struct libinput_event_keyboard *key;
+	struct libinput_event_pointer *ptr;
+	struct libinput_event_gesture *gesture;
+	struct libinput_event_touch *touch;
+	struct libinput_event_switch *sw;
+
+	if (size < offsetof(struct libinput_event_record, u))
+		return -EINVAL;
+
+	memset(&rec, 0, sizeof(rec));
+	rec.type = event->type;
+	rec.device = event->device;
+
+	switch (event->type) {
+	case LIBINPUT_EVENT_KEYBOARD_KEY:
+		key = (struct libinput_event_keyboard *)event;
+		rec.time = key->time;
+		rec.u.keyboard.key = key->key;
+		rec.u.keyboard.state = key->state;
+		rec.u.keyboard.seat_key_count = key->seat_key_count;
+		rec.u.keyboard.keysym = key->keysym;
+		break;
+	case LIBINPUT_EVENT_POINTER_MOTION:
+		ptr = (struct libinput_event_pointer *)event;
+		rec.time = ptr->time;
+		rec.u.motion.dx = ptr->delta.x;
+		rec.u.motion.dy = ptr->delta.y;
+		rec.u.motion.dx_unaccelerated = ptr->delta_raw.x;
+		rec.u.motion.dy_unaccelerated = ptr->delta_raw.y;
+		break;
+	case LIBINPUT_EVENT_POINTER_BUTTON:
+		ptr = (struct libinput_event_pointer *)event;
+		rec.time = ptr->time;
+		rec.u.button.button = ptr->button;
+		rec.u.button.state = ptr->state;
+		rec.u.button.seat_button_count = ptr->seat_button_count;
+		break;
+	case LIBINPUT_EVENT_POINTER_SCROLL_WHEEL:
+	case LIBINPUT_EVENT_POINTER_SCROLL_FINGER:
+	case LIBINPUT_EVENT_POINTER_SCROLL_CONTINUOUS:
+		ptr = (struct libinput_event_pointer *)event;
+		rec.time = ptr->time;
+		rec.u.scroll.axes = ptr->axes;
+		rec.u.scroll.value[LIBINPUT_POINTER_AXIS_SCROLL_VERTICAL] =
+			ptr->delta.y;
+		rec.u.scroll.value[LIBINPUT_POINTER_AXIS_SCROLL_HORIZONTAL] =
+			ptr->delta.x;
+		rec.u.scroll.value_v120[LIBINPUT_POINTER_AXIS_SCROLL_VERTICAL] =
+			ptr->v120.y;
+		rec.u.scroll.value_v120[LIBINPUT_POINTER_AXIS_SCROLL_HORIZONTAL] =
+			ptr->v120.x;
+		break;
+	case LIBINPUT_EVENT_GESTURE_HOLD_BEGIN:
+	case LIBINPUT_EVENT_GESTURE_HOLD_END:
+		gesture = (struct libinput_event_gesture *)event;
+		rec.time = gesture->time;
+		rec.u.gesture.finger_count = gesture->finger_count;
+		rec.u.gesture.cancelled = gesture->cancelled;
+		break;
+	case LIBINPUT_EVENT_TABLET_PAD_BUTTON:
+	case LIBINPUT_EVENT_TABLET_PAD_RING:
+	case LIBINPUT_EVENT_TABLET_PAD_STRIP:
+	case LIBINPUT_EVENT_TABLET_PAD_KEY:
+		rec.time = ((struct libinput_event_tablet_pad *)event)->time;
+		break;
+	case LIBINPUT_EVENT_TOUCH_DOWN:
+	case LIBINPUT_EVENT_TOUCH_UP:
+	case LIBINPUT_EVENT_TOUCH_MOTION:
+	case LIBINPUT_EVENT_TOUCH_CANCEL:
+	case LIBINPUT_EVENT_TOUCH_FRAME:
+		touch = (struct libinput_event_touch *)event;
+		rec.time = touch->time;
+		rec.u.touch.slot = touch->slot;
+		rec.u.touch.seat_slot = touch->seat_slot;
+		break;
+	case LIBINPUT_EVENT_SWITCH_TOGGLE:
+		sw = (struct libinput_event_switch *)event;
+		rec.time = sw->time;
+		rec.u.sw.sw = sw->sw;
+		rec.u.sw.state = sw->state;
+		break;
+	default:
+		break;
+	}
+
+	size = min(size, sizeof(rec));
+	rec.size = size;
+	memcpy(record, &rec, size);
+
+	return size;
+}
+
 LIBINPUT_EXPORT uint32_t
 libinput_event_keyboard_get_time(struct libinput_event_keyboard *event)
 {
@@ -360,6 +577,17 @@ libinput_event_keyboard_get_seat_key_count(
 	return event->seat_key_count;
 }
 
+LIBINPUT_EXPORT uint32_t
+libinput_event_keyboard_get_keysym(struct libinput_event_keyboard *event)
+{
+	require_event_type(libinput_event_get_context(&event->base),
+			   event->base.type,
+			   0,
+			   LIBINPUT_EVENT_KEYBOARD_KEY);
+
+	return event->keysym;
+}
+
 LIBINPUT_EXPORT uint32_t
 libinput_event_pointer_get_time(struct libinput_event_pointer *event)
 {
@@ -533,6 +761,7 @@ libinput_event_pointer_has_axis(struct libinput_event_pointer *event,
 			   event->base.type,
 			   0,
 			   LIBINPUT_EVENT_POINTER_SCROLL_WHEEL,
+			   LIBINPUT_EVENT_POINTER_SCROLL_FINGER,
 			   LIBINPUT_EVENT_POINTER_AXIS);
 
 	switch (axis) {
@@ -635,6 +864,28 @@ libinput_event_pointer_get_scroll_value_v120(struct libinput_event_pointer *even
 	return value;
 }
 
+/* Touchscreens without a resolution are taken to have one unit per mm */
+static double
+touch_to_mm(struct libinput_device *device, int axis, int value)
+{
+	int minimum = axis ? device->abs.min.y : device->abs.min.x;
+	int res = axis ? device->abs.res.y : device->abs.res.x;
+
+	return (double)(value - minimum) / (res > 0 ? res : 1);
+}
+
+static double
+touch_transform(struct libinput_device *device,
+		int axis,
+		int value,
+		uint32_t size)
+{
+	int minimum = axis ? device->abs.min.y : device->abs.min.x;
+	int maximum = axis ? device->abs.max.y : device->abs.max.x;
+
+	return (double)(value - minimum) * size / (maximum - minimum + 1);
+}
+
 LIBINPUT_EXPORT uint32_t
 libinput_event_touch_get_time(struct libinput_event_touch *event)
 {
@@ -675,7 +926,7 @@ libinput_event_touch_get_slot(struct libinput_event_touch *event)
 			   LIBINPUT_EVENT_TOUCH_UP,
 			   LIBINPUT_EVENT_TOUCH_MOTION,
 			   LIBINPUT_EVENT_TOUCH_CANCEL);
-	fprintf(stderr, "%s: partial stub\n", __func__);
+
 	return event->slot;
 }
 
@@ -690,7 +941,6 @@ libinput_event_touch_get_seat_slot(struct libinput_event_touch *event)
 			   LIBINPUT_EVENT_TOUCH_MOTION,
 			   LIBINPUT_EVENT_TOUCH_CANCEL);
 
-	fprintf(stderr, "%s: partial stub\n", __func__);
 	return event->seat_slot;
 }
 
@@ -703,8 +953,7 @@ libinput_event_touch_get_x(struct libinput_event_touch *event)
 			   LIBINPUT_EVENT_TOUCH_DOWN,
 			   LIBINPUT_EVENT_TOUCH_MOTION);
 
-	fprintf(stderr, "%s: stub\n", __func__);
-	return (double)(-1);
+	return touch_to_mm(event->base.device, 0, event->point.x);
 }
 
 LIBINPUT_EXPORT double
@@ -717,8 +966,8 @@ libinput_event_touch_get_x_transformed(struct libinput_event_touch *event,
 			   LIBINPUT_EVENT_TOUCH_DOWN,
 			   LIBINPUT_EVENT_TOUCH_MOTION);
 
-	fprintf(stderr, "%s: stub\n", __func__);
-	return (double)(-1);
+	return touch_transform(event->base.device, 0, event->point.x,
+			       width);
 }
 
 LIBINPUT_EXPORT double
@@ -731,8 +980,8 @@ libinput_event_touch_get_y_transformed(struct libinput_event_touch *event,
 			   LIBINPUT_EVENT_TOUCH_DOWN,
 			   LIBINPUT_EVENT_TOUCH_MOTION);
 
-	fprintf(stderr, "%s: stub\n", __func__);
-	return (double)(-1);
+	return touch_transform(event->base.device, 1, event->point.y,
+			       height);
 }
 
 LIBINPUT_EXPORT double
@@ -744,8 +993,7 @@ libinput_event_touch_get_y(struct libinput_event_touch *event)
 			   LIBINPUT_EVENT_TOUCH_DOWN,
 			   LIBINPUT_EVENT_TOUCH_MOTION);
 
-	fprintf(stderr, "%s: stub\n", __func__);
-	return (double)(-1);
+	return touch_to_mm(event->base.device, 1, event->point.y);
 }
 
 LIBINPUT_EXPORT uint32_t
@@ -759,7 +1007,9 @@ libinput_event_gesture_get_time(struct libinput_event_gesture *event)
 			   LIBINPUT_EVENT_GESTURE_PINCH_END,
 			   LIBINPUT_EVENT_GESTURE_SWIPE_BEGIN,
 			   LIBINPUT_EVENT_GESTURE_SWIPE_UPDATE,
-			   LIBINPUT_EVENT_GESTURE_SWIPE_END);
+			   LIBINPUT_EVENT_GESTURE_SWIPE_END,
+			   LIBINPUT_EVENT_GESTURE_HOLD_BEGIN,
+			   LIBINPUT_EVENT_GESTURE_HOLD_END);
 
 	return us2ms(event->time);
 }
@@ -775,7 +1025,9 @@ libinput_event_gesture_get_time_usec(struct libinput_event_gesture *event)
 			   LIBINPUT_EVENT_GESTURE_PINCH_END,
 			   LIBINPUT_EVENT_GESTURE_SWIPE_BEGIN,
 			   LIBINPUT_EVENT_GESTURE_SWIPE_UPDATE,
-			   LIBINPUT_EVENT_GESTURE_SWIPE_END);
+			   LIBINPUT_EVENT_GESTURE_SWIPE_END,
+			   LIBINPUT_EVENT_GESTURE_HOLD_BEGIN,
+			   LIBINPUT_EVENT_GESTURE_HOLD_END);
 
 	return event->time;
 }
@@ -791,9 +1043,10 @@ libinput_event_gesture_get_finger_count(struct libinput_event_gesture *event)
 			   LIBINPUT_EVENT_GESTURE_PINCH_END,
 			   LIBINPUT_EVENT_GESTURE_SWIPE_BEGIN,
 			   LIBINPUT_EVENT_GESTURE_SWIPE_UPDATE,
-			   LIBINPUT_EVENT_GESTURE_SWIPE_END);
+			   LIBINPUT_EVENT_GESTURE_SWIPE_END,
+			   LIBINPUT_EVENT_GESTURE_HOLD_BEGIN,
+			   LIBINPUT_EVENT_GESTURE_HOLD_END);
 
-	fprintf(stderr, "%s: partial stub\n", __func__);
 	return event->finger_count;
 }
 
@@ -804,9 +1057,9 @@ libinput_event_gesture_get_cancelled(struct libinput_event_gesture *event)
 			   event->base.type,
 			   0,
 			   LIBINPUT_EVENT_GESTURE_PINCH_END,
-			   LIBINPUT_EVENT_GESTURE_SWIPE_END);
+			   LIBINPUT_EVENT_GESTURE_SWIPE_END,
+			   LIBINPUT_EVENT_GESTURE_HOLD_END);
 
-	fprintf(stderr, "%s: partial stub\n", __func__);
 	return event->cancelled;
 }
 
@@ -969,6 +1222,9 @@ libinput_init(struct libinput *libinput,
 	libinput->refcount = 1;
 	list_init(&libinput->source_destroy_list);
 	list_init(&libinput->seat_list);
+	list_init(&libinput->timer.list);
+	list_init(&libinput->keymap_list);
+	list_init(&libinput->device_group_list);
 
 	return 0;
 }
@@ -979,6 +1235,9 @@ libinput_device_destroy(struct libinput_device *device);
 static void
 libinput_seat_destroy(struct libinput_seat *seat);
 
+static void
+libinput_seat_idle_timeout(uint64_t now, void *data);
+
 static void
 libinput_drop_destroyed_sources(struct libinput *libinput)
 {
@@ -1002,6 +1261,7 @@ libinput_unref(struct libinput *libinput)
 	struct libinput_event *event;
 	struct libinput_device *device, *next_device;
 	struct libinput_seat *seat, *next_seat;
+	struct libinput_device_group *group, *next_group;
 
 	if (libinput == NULL)
 		return NULL;
@@ -1016,6 +1276,8 @@ libinput_unref(struct libinput *libinput)
 
 	free(libinput->events);
 
+	busypoll_destroy(libinput);
+
 	list_for_each_safe(seat, next_seat, &libinput->seat_list, link) {
 		list_for_each_safe(device, next_device,
 				   &seat->devices_list,
@@ -1025,23 +1287,57 @@ libinput_unref(struct libinput *libinput)
 		libinput_seat_destroy(seat);
 	}
 
+	/* Groups still referenced by the caller outlive the context */
+	list_for_each_safe(group, next_group,
+			   &libinput->device_group_list, link) {
+		list_remove(&group->link);
+		list_init(&group->link);
+	}
+
 	libinput_drop_destroyed_sources(libinput);
+	libinput_event_pool_drain(libinput);
+	libinput_trace_disable(libinput);
+	free(libinput->keymap_cache_dir);
 	close(libinput->kq);
 	free(libinput);
 
 	return NULL;
 }
 
-LIBINPUT_EXPORT void
-libinput_event_destroy(struct libinput_event *event)
+LIBINPUT_EXPORT struct libinput_event *
+libinput_event_ref(struct libinput_event *event)
+{
+	assert(event->refcount > 0);
+	event->refcount++;
+	return event;
+}
+
+LIBINPUT_EXPORT struct libinput_event *
+libinput_event_unref(struct libinput_event *event)
 {
+	struct libinput *libinput = NULL;
+
 	if (event == NULL)
-		return;
+		return NULL;
 
-	if (event->device)
+	assert(event->refcount > 0);
+	event->refcount--;
+	if (event->refcount > 0)
+		return event;
+
+	if (event->device) {
+		libinput = event->device->seat->libinput;
 		libinput_device_unref(event->device);
+	}
+	libinput_event_release(libinput, event);
+
+	return NULL;
+}
 
-	free(event);
+LIBINPUT_EXPORT void
+libinput_event_destroy(struct libinput_event *event)
+{
+	libinput_event_unref(event);
 }
 
 int
@@ -1059,6 +1355,17 @@ close_restricted(struct libinput *libinput, int fd)
 	return libinput->interface->close_restricted(fd, libinput->user_data);
 }
 
+static uint64_t
+seat_idle_time(struct libinput_seat *seat)
+{
+	uint64_t now = libinput_now(seat->libinput);
+
+	if (now < seat->idle.last_activity)
+		return 0;
+
+	return now - seat->idle.last_activity;
+}
+
 void
 libinput_seat_init(struct libinput_seat *seat,
 		   struct libinput *libinput,
@@ -1071,6 +1378,10 @@ libinput_seat_init(struct libinput_seat *seat,
 	seat->logical_name = strdup(logical_name);
 	list_init(&seat->devices_list);
 	list_insert(&libinput->seat_list, &seat->link);
+
+	seat->idle.last_activity = libinput_now(libinput);
+	libinput_timer_init(&seat->idle.timer, libinput,
+			    libinput_seat_idle_timeout, seat);
 }
 
 LIBINPUT_EXPORT struct libinput_seat *
@@ -1083,6 +1394,7 @@ libinput_seat_ref(struct libinput_seat *seat)
 static void
 libinput_seat_destroy(struct libinput_seat *seat)
 {
+	libinput_timer_cancel(&seat->idle.timer);
 	list_remove(&seat->link);
 	free(seat->logical_name);
 	free(seat->physical_name);
@@ -1102,6 +1414,59 @@ libinput_seat_unref(struct libinput_seat *seat)
 	}
 }
 
+static void
+libinput_seat_idle_timeout(uint64_t now, void *data)
+{
+	struct libinput_seat *seat = data;
+	uint64_t idle = seat_idle_time(seat);
+
+	/* Activity only stores its time, catch up with it here */
+	if (idle < seat->idle.timeout) {
+		libinput_timer_set(&seat->idle.timer,
+				   now + seat->idle.timeout - idle);
+		return;
+	}
+
+	seat->idle.idle = true;
+	seat->idle.handler(seat, true, seat->idle.user_data);
+}
+
+void
+seat_idle_end(struct libinput_seat *seat)
+{
+	seat->idle.idle = false;
+	libinput_timer_set(&seat->idle.timer,
+			   libinput_now(seat->libinput) + seat->idle.timeout);
+	seat->idle.handler(seat, false, seat->idle.user_data);
+}
+
+LIBINPUT_EXPORT uint64_t
+libinput_seat_get_idle_time(struct libinput_seat *seat)
+{
+	return seat_idle_time(seat);
+}
+
+LIBINPUT_EXPORT void
+libinput_seat_set_idle_handler(struct libinput_seat *seat,
+			       uint64_t timeout,
+			       libinput_seat_idle_handler handler,
+			       void *user_data)
+{
+	libinput_timer_cancel(&seat->idle.timer);
+	seat->idle.idle = false;
+	seat->idle.timeout = timeout;
+	seat->idle.handler = handler;
+	seat->idle.user_data = user_data;
+
+	if (handler == NULL || timeout == 0) {
+		seat->idle.handler = NULL;
+		return;
+	}
+
+	libinput_timer_set(&seat->idle.timer, libinput_now(seat->libinput) +
+			   timeout - min(seat_idle_time(seat), timeout));
+}
+
 LIBINPUT_EXPORT void
 libinput_seat_set_user_data(struct libinput_seat *seat, void *user_data)
 {
@@ -1139,6 +1504,7 @@ libinput_device_init(struct libinput_device *device,
 {
 	device->seat = seat;
 	device->refcount = 1;
+	device->read_now = libinput_now(seat->libinput);
 }
 
 LIBINPUT_EXPORT struct libinput_device *
@@ -1151,8 +1517,22 @@ libinput_device_ref(struct libinput_device *device)
 static void
 libinput_device_destroy(struct libinput_device *device)
 {
+	/* Pending timers are still linked into the context's list */
+	libinput_timer_cancel(&device->open_timer);
+	libinput_timer_cancel(&device->wheel.timer);
+	libinput_timer_cancel(&device->tp.hold.timer);
+
+	if (device->group != NULL) {
+		if (device->group->pen == device)
+			device->group->pen = NULL;
+		list_remove(&device->group_link);
+		libinput_device_group_unref(device->group);
+	}
 	list_remove(&device->link);
 	libinput_seat_unref(device->seat);
+	flight_recorder_destroy(device->recorder);
+	keymap_unref(device->keymap);
+	free(device->devname);
 	free(device);
 }
 
@@ -1181,13 +1561,22 @@ libinput_dispatch(struct libinput *libinput)
 	struct libinput_source *source;
 	struct kevent kev[1];
 	struct timespec ts = { 0, 0 };
+	uint64_t trace_time;
 	int i, count;
 
+	trace_time = trace_begin(libinput);
+
 	count = kevent(libinput->kq, NULL, 0, kev, ARRAY_LENGTH(kev), &ts);
 	if (count == -1)
 		return -errno;
 
 	for (i = 0; i < count; i++) {
+		if (kev[i].filter == EVFILT_TIMER) {
+			/* one-shot, expired timers are run below */
+			libinput->timer.next_expiry = 0;
+			continue;
+		}
+
 		if (kev[i].filter != EVFILT_READ)
 			continue;
 
@@ -1198,8 +1587,14 @@ libinput_dispatch(struct libinput *libinput)
 		source->dispatch(source->user_data);
 	}
 
+	if (libinput->busypoll != NULL)
+		busypoll_drain(libinput);
+
+	libinput_timer_handler(libinput);
 	libinput_drop_destroyed_sources(libinput);
 
+	trace_end(libinput, TRACE_SPAN_DISPATCH, trace_time, count);
+
 	return 0;
 }
 
@@ -1252,6 +1647,7 @@ init_event_base(struct libinput_event *event,
 {
 	event->type = type;
 	event->device = device;
+	event->refcount = 1;
 }
 
 void
@@ -1261,6 +1657,7 @@ post_device_event(struct libinput_device *device,
 		  struct libinput_event *event)
 {
 	init_event_base(event, device, type);
+	device->stats.events++;
 	libinput_post_event(device->seat->libinput, event);
 }
 
@@ -1317,17 +1714,27 @@ keyboard_notify_key(struct libinput_device *device,
 	if (!device_has_cap(device, LIBINPUT_DEVICE_CAP_KEYBOARD))
 		return;
 
-	key_event = zalloc(sizeof *key_event);
+	/* Already released, e.g. by the resync after an overflow */
+	if (state == LIBINPUT_KEY_STATE_RELEASED &&
+	    !long_bit_is_set(device->key_mask, key))
+		return;
+
+	device_notify_activity(device);
+
+	key_event = libinput_event_alloc(device->seat->libinput);
 	if (!key_event)
 		return;
 
 	seat_key_count = update_seat_key_count(device->seat, key, state);
+	long_set_bit_state(device->key_mask, key,
+			   state == LIBINPUT_KEY_STATE_PRESSED);
 
 	*key_event = (struct libinput_event_keyboard) {
 		.time = time,
 		.key = key,
 		.state = state,
 		.seat_key_count = seat_key_count,
+		.keysym = keymap_process_key(device, key, state),
 	};
 	post_device_event(device, time,
 			  LIBINPUT_EVENT_KEYBOARD_KEY,
@@ -1343,7 +1750,9 @@ axis_notify_event(struct libinput_device *device,
 	struct libinput_event_pointer *axis_event;
 	uint32_t axes;
 
-	axis_event = zalloc(sizeof *axis_event);
+	device_notify_activity(device);
+
+	axis_event = libinput_event_alloc(device->seat->libinput);
 	if (!axis_event)
 		return;
 	if (delta->x)
@@ -1363,6 +1772,123 @@ axis_notify_event(struct libinput_device *device,
 	    &axis_event->base);
 }
 
+void
+gesture_notify_hold(struct libinput_device *device,
+		    uint64_t time,
+		    int finger_count)
+{
+	struct libinput_event_gesture *gesture_event;
+
+	if (!device_has_cap(device, LIBINPUT_DEVICE_CAP_GESTURE))
+		return;
+
+	device_notify_activity(device);
+
+	gesture_event = libinput_event_alloc(device->seat->libinput);
+	if (!gesture_event)
+		return;
+
+	*gesture_event = (struct libinput_event_gesture) {
+		.time = time,
+		.finger_count = finger_count,
+	};
+
+	post_device_event(device, time,
+			  LIBINPUT_EVENT_GESTURE_HOLD_BEGIN,
+			  &gesture_event->base);
+}
+
+void
+gesture_notify_hold_end(struct libinput_device *device,
+			uint64_t time,
+			int finger_count,
+			bool cancelled)
+{
+	struct libinput_event_gesture *gesture_event;
+
+	if (!device_has_cap(device, LIBINPUT_DEVICE_CAP_GESTURE))
+		return;
+
+	gesture_event = libinput_event_alloc(device->seat->libinput);
+	if (!gesture_event)
+		return;
+
+	*gesture_event = (struct libinput_event_gesture) {
+		.time = time,
+		.finger_count = finger_count,
+		.cancelled = cancelled,
+	};
+
+	post_device_event(device, time,
+			  LIBINPUT_EVENT_GESTURE_HOLD_END,
+			  &gesture_event->base);
+}
+
+void
+pointer_notify_scroll_wheel(struct libinput_device *device,
+			    uint64_t time,
+			    const struct normalized_coords *delta,
+			    const struct wheel_v120 *v120)
+{
+	struct libinput_event_pointer *scroll_event;
+	uint32_t axes = 0;
+
+	if (!device_has_cap(device, LIBINPUT_DEVICE_CAP_POINTER))
+		return;
+
+	device_notify_activity(device);
+
+	scroll_event = libinput_event_alloc(device->seat->libinput);
+	if (!scroll_event)
+		return;
+
+	if (delta->x != 0 || v120->x != 0)
+		axes |= bit(LIBINPUT_POINTER_AXIS_SCROLL_HORIZONTAL);
+	if (delta->y != 0 || v120->y != 0)
+		axes |= bit(LIBINPUT_POINTER_AXIS_SCROLL_VERTICAL);
+
+	*scroll_event = (struct libinput_event_pointer) {
+		.time = time,
+		.delta = *delta,
+		.v120 = *v120,
+		.source = LIBINPUT_POINTER_AXIS_SOURCE_WHEEL,
+		.axes = axes,
+	};
+
+	post_device_event(device, time,
+			  LIBINPUT_EVENT_POINTER_SCROLL_WHEEL,
+			  &scroll_event->base);
+}
+
+void
+pointer_notify_scroll_finger(struct libinput_device *device,
+			     uint64_t time,
+			     uint32_t axes,
+			     const struct normalized_coords *delta)
+{
+	struct libinput_event_pointer *scroll_event;
+
+	if (!device_has_cap(device, LIBINPUT_DEVICE_CAP_POINTER))
+		return;
+
+	device_notify_activity(device);
+
+	scroll_event = libinput_event_alloc(device->seat->libinput);
+	if (!scroll_event)
+		return;
+
+	*scroll_event = (struct libinput_event_pointer) {
+		.time = time,
+		.delta = *delta,
+		.source = LIBINPUT_POINTER_AXIS_SOURCE_FINGER,
+		.axes = axes,
+	};
+
+	post_device_event(device, time,
+			  LIBINPUT_EVENT_POINTER_SCROLL_FINGER,
+			  &scroll_event->base);
+}
+
 void
 pointer_notify_motion(struct libinput_device *device,
 		      uint64_t time,
@@ -1374,7 +1900,9 @@ pointer_notify_motion(struct libinput_device *device,
 	if (!device_has_cap(device, LIBINPUT_DEVICE_CAP_POINTER))
 		return;
 
-	motion_event = zalloc(sizeof *motion_event);
+	device_notify_activity(device);
+
+	motion_event = libinput_event_alloc(device->seat->libinput);
 	if (!motion_event)
 		return;
 
@@ -1401,13 +1929,21 @@ pointer_notify_button(struct libinput_device *device,
 	if (!device_has_cap(device, LIBINPUT_DEVICE_CAP_POINTER))
 		return;
 
-	button_event = zalloc(sizeof *button_event);
+	if (state == LIBINPUT_BUTTON_STATE_RELEASED &&
+	    !long_bit_is_set(device->key_mask, button))
+		return;
+
+	device_notify_activity(device);
+
+	button_event = libinput_event_alloc(device->seat->libinput);
 	if (!button_event)
 		return;
 
 	seat_button_count = update_seat_button_count(device->seat,
 						     button,
 						     state);
+	long_set_bit_state(device->key_mask, button,
+			   state == LIBINPUT_BUTTON_STATE_PRESSED);
 
 	*button_event = (struct libinput_event_pointer) {
 		.time = time,
@@ -1420,25 +1956,231 @@ pointer_notify_button(struct libinput_device *device,
 			  LIBINPUT_EVENT_POINTER_BUTTON,
 			  &button_event->base);
 }
-static void
-libinput_post_event(struct libinput *libinput,
-		    struct libinput_event *event)
+
+void
+tablet_pad_notify_button(struct libinput_device *device,
+			 uint64_t time,
+			 int32_t button,
+			 enum libinput_button_state state,
+			 struct libinput_tablet_pad_mode_group *group)
 {
-	struct libinput_event **events = libinput->events;
-	size_t events_len = libinput->events_len;
-	size_t events_count = libinput->events_count;
-	size_t move_len;
-	size_t new_out;
+	struct libinput_event_tablet_pad *button_event;
 
-	events_count++;
-	if (events_count > events_len) {
-		events_len *= 2;
-		events = realloc(events, events_len * sizeof *events);
-		if (!events) {
-			fprintf(stderr, "Failed to reallocate event ring "
-				"buffer");
-			return;
-		}
+	if (!device_has_cap(device, LIBINPUT_DEVICE_CAP_TABLET_PAD))
+		return;
+
+	device_notify_activity(device);
+
+	button_event = libinput_event_alloc(device->seat->libinput);
+	if (!button_event)
+		return;
+
+	*button_event = (struct libinput_event_tablet_pad) {
+		.time = time,
+		.button.number = button,
+		.button.state = state,
+		.mode_group = group,
+		.mode = group->mode,
+	};
+
+	post_device_event(device, time,
+			  LIBINPUT_EVENT_TABLET_PAD_BUTTON,
+			  &button_event->base);
+}
+
+void
+tablet_pad_notify_ring(struct libinput_device *device,
+		       uint64_t time,
+		       unsigned int number,
+		       double value,
+		       enum libinput_tablet_pad_ring_axis_source source,
+		       struct libinput_tablet_pad_mode_group *group)
+{
+	struct libinput_event_tablet_pad *ring_event;
+
+	if (!device_has_cap(device, LIBINPUT_DEVICE_CAP_TABLET_PAD))
+		return;
+
+	device_notify_activity(device);
+
+	ring_event = libinput_event_alloc(device->seat->libinput);
+	if (!ring_event)
+		return;
+
+	*ring_event = (struct libinput_event_tablet_pad) {
+		.time = time,
+		.ring.number = number,
+		.ring.position = value,
+		.ring.source = source,
+		.mode_group = group,
+		.mode = group->mode,
+	};
+
+	post_device_event(device, time,
+			  LIBINPUT_EVENT_TABLET_PAD_RING,
+			  &ring_event->base);
+}
+
+void
+tablet_pad_notify_strip(struct libinput_device *device,
+			uint64_t time,
+			unsigned int number,
+			double value,
+			enum libinput_tablet_pad_strip_axis_source source,
+			struct libinput_tablet_pad_mode_group *group)
+{
+	struct libinput_event_tablet_pad *strip_event;
+
+	if (!device_has_cap(device, LIBINPUT_DEVICE_CAP_TABLET_PAD))
+		return;
+
+	device_notify_activity(device);
+
+	strip_event = libinput_event_alloc(device->seat->libinput);
+	if (!strip_event)
+		return;
+
+	*strip_event = (struct libinput_event_tablet_pad) {
+		.time = time,
+		.strip.number = number,
+		.strip.position = value,
+		.strip.source = source,
+		.mode_group = group,
+		.mode = group->mode,
+	};
+
+	post_device_event(device, time,
+			  LIBINPUT_EVENT_TABLET_PAD_STRIP,
+			  &strip_event->base);
+}
+
+static void
+touch_notify_event(struct libinput_device *device,
+		   uint64_t time,
+		   enum libinput_event_type type,
+		   int32_t slot,
+		   int32_t seat_slot,
+		   const struct device_coords *point)
+{
+	struct libinput_event_touch *touch_event;
+
+	if (!device_has_cap(device, LIBINPUT_DEVICE_CAP_TOUCH))
+		return;
+
+	device_notify_activity(device);
+
+	touch_event = libinput_event_alloc(device->seat->libinput);
+	if (!touch_event)
+		return;
+
+	*touch_event = (struct libinput_event_touch) {
+		.time = time,
+		.slot = slot,
+		.seat_slot = seat_slot,
+	};
+	if (point != NULL)
+		touch_event->point = *point;
+
+	post_device_event(device, time, type, &touch_event->base);
+}
+
+void
+touch_notify_touch_down(struct libinput_device *device,
+			uint64_t time,
+			int32_t slot,
+			int32_t seat_slot,
+			const struct device_coords *point)
+{
+	touch_notify_event(device, time, LIBINPUT_EVENT_TOUCH_DOWN,
+			   slot, seat_slot, point);
+}
+
+void
+touch_notify_touch_motion(struct libinput_device *device,
+			  uint64_t time,
+			  int32_t slot,
+			  int32_t seat_slot,
+			  const struct device_coords *point)
+{
+	touch_notify_event(device, time, LIBINPUT_EVENT_TOUCH_MOTION,
+			   slot, seat_slot, point);
+}
+
+void
+touch_notify_touch_up(struct libinput_device *device,
+		      uint64_t time,
+		      int32_t slot,
+		      int32_t seat_slot)
+{
+	touch_notify_event(device, time, LIBINPUT_EVENT_TOUCH_UP,
+			   slot, seat_slot, NULL);
+}
+
+void
+touch_notify_touch_cancel(struct libinput_device *device,
+			  uint64_t time,
+			  int32_t slot,
+			  int32_t seat_slot)
+{
+	touch_notify_event(device, time, LIBINPUT_EVENT_TOUCH_CANCEL,
+			   slot, seat_slot, NULL);
+}
+
+void
+touch_notify_frame(struct libinput_device *device, uint64_t time)
+{
+	touch_notify_event(device, time, LIBINPUT_EVENT_TOUCH_FRAME,
+			   -1, -1, NULL);
+}
+
+void
+switch_notify_toggle(struct libinput_device *device,
+		     uint64_t time,
+		     enum libinput_switch sw,
+		     enum libinput_switch_state state)
+{
+	struct libinput_event_switch *switch_event;
+
+	if (!device_has_cap(device, LIBINPUT_DEVICE_CAP_SWITCH))
+		return;
+
+	switch_event = libinput_event_alloc(device->seat->libinput);
+	if (!switch_event)
+		return;
+
+	*switch_event = (struct libinput_event_switch) {
+		.time = time,
+		.sw = sw,
+		.state = state,
+	};
+
+	post_device_event(device, time,
+			  LIBINPUT_EVENT_SWITCH_TOGGLE,
+			  &switch_event->base);
+}
+
+static void
+libinput_post_event(struct libinput *libinput,
+		    struct libinput_event *event)
+{
+	struct libinput_event **events = libinput->events;
+	size_t events_len = libinput->events_len;
+	size_t events_count = libinput->events_count;
+	size_t move_len;
+	size_t new_out;
+	uint64_t trace_time;
+
+	trace_time = trace_begin(libinput);
+
+	events_count++;
+	if (events_count > events_len) {
+		events_len *= 2;
+		events = realloc(events, events_len * sizeof *events);
+		if (!events) {
+			fprintf(stderr, "Failed to reallocate event ring "
+				"buffer");
+			return;
+		}
 
 		if (libinput->events_count > 0 && libinput->events_in == 0) {
 			libinput->events_in = libinput->events_len;
@@ -1462,20 +2204,28 @@ libinput_post_event(struct libinput *libinput,
 	libinput->events_count = events_count;
 	events[libinput->events_in] = event;
 	libinput->events_in = (libinput->events_in + 1) % libinput->events_len;
+
+	trace_end(libinput, TRACE_SPAN_POST, trace_time, event->type);
 }
 
 LIBINPUT_EXPORT struct libinput_event *
 libinput_get_event(struct libinput *libinput)
 {
 	struct libinput_event *event;
+	uint64_t trace_time;
 
 	if (libinput->events_count == 0)
 		return NULL;
 
+	trace_time = trace_begin(libinput);
+
 	event = libinput->events[libinput->events_out];
 	libinput->events_out =
 		(libinput->events_out + 1) % libinput->events_len;
 	libinput->events_count--;
+
+	trace_end(libinput, TRACE_SPAN_DEQUEUE, trace_time, event->type);
+
 	return event;
 }
 
@@ -1536,8 +2286,7 @@ libinput_device_get_context(struct libinput_device *device)
 LIBINPUT_EXPORT struct libinput_device_group *
 libinput_device_get_device_group(struct libinput_device *device)
 {
-	/* We do not support device groups. */
-	return NULL;
+	return device->group;
 }
 
 LIBINPUT_EXPORT const char *
@@ -1601,24 +2350,7 @@ LIBINPUT_EXPORT int
 libinput_device_has_capability(struct libinput_device *device,
        enum libinput_device_capability capability)
 {
-	int rc = 0;
-
-	switch (capability) {
-	case LIBINPUT_DEVICE_CAP_POINTER:
-		if (strncmp(device->devname, "/dev/wsmouse", 12) == 0)
-			rc = 1;
-		break;
-	case LIBINPUT_DEVICE_CAP_KEYBOARD:
-		if (strncmp(device->devname, "/dev/wskbd", 10) == 0)
-			rc = 1;
-		break;
-	case LIBINPUT_DEVICE_CAP_TOUCH:
-	case LIBINPUT_DEVICE_CAP_GESTURE:
-	default:
-		break;
-	}
-
-	return rc;
+	return !!(device->caps & bit(capability));
 }
 
 LIBINPUT_EXPORT int
@@ -1701,32 +2433,95 @@ libinput_event_gesture_get_base_event(struct libinput_event_gesture *event)
 	return &event->base;
 }
 
+struct libinput_device_group *
+libinput_device_group_create(struct libinput *libinput,
+			     const char *identifier)
+{
+	struct libinput_device_group *group;
+
+	group = zalloc(sizeof(*group));
+	if (group == NULL)
+		return NULL;
+
+	if (identifier != NULL &&
+	    (group->identifier = strdup(identifier)) == NULL) {
+		free(group);
+		return NULL;
+	}
+
+	group->refcount = 1;
+	list_init(&group->devices);
+	list_insert(&libinput->device_group_list, &group->link);
+
+	return group;
+}
+
+/* Groups left by their last device are never reused */
+struct libinput_device_group *
+libinput_device_group_find_group(struct libinput *libinput,
+				 const char *identifier)
+{
+	struct libinput_device_group *group;
+
+	list_for_each(group, &libinput->device_group_list, link) {
+		if (group->identifier != NULL &&
+		    streq(group->identifier, identifier) &&
+		    !list_empty(&group->devices))
+			return group;
+	}
+
+	return NULL;
+}
+
+void
+libinput_device_set_device_group(struct libinput_device *device,
+				 struct libinput_device_group *group)
+{
+	libinput_device_group_ref(group);
+	if (device->group != NULL) {
+		if (device->group->pen == device)
+			device->group->pen = NULL;
+		list_remove(&device->group_link);
+		libinput_device_group_unref(device->group);
+	}
+
+	device->group = group;
+	list_insert(&group->devices, &device->group_link);
+}
+
 LIBINPUT_EXPORT struct libinput_device_group *
 libinput_device_group_ref(struct libinput_device_group *group)
 {
-	assert(group == NULL);
-	return NULL; // XXX
+	group->refcount++;
+	return group;
 }
 
 LIBINPUT_EXPORT struct libinput_device_group *
 libinput_device_group_unref(struct libinput_device_group *group)
 {
-	assert(group == NULL);
-	return NULL; // XXX
+	assert(group->refcount > 0);
+	group->refcount--;
+	if (group->refcount > 0)
+		return group;
+
+	list_remove(&group->link);
+	free(group->identifier);
+	free(group);
+
+	return NULL;
 }
 
 LIBINPUT_EXPORT void
 libinput_device_group_set_user_data(struct libinput_device_group *group,
 				    void *user_data)
 {
-	assert(group == NULL);
+	group->user_data = user_data;
 }
 
 LIBINPUT_EXPORT void *
 libinput_device_group_get_user_data(struct libinput_device_group *group)
 {
-	assert(group == NULL);
-	return NULL; // XXX
+	return group->user_data;
 }
 
 LIBINPUT_EXPORT const char *
@@ -1820,23 +2615,59 @@ libinput_device_config_calibration_get_default_matrix(struct libinput_device *de
 	return 0;
 }
 
+/* Inside a transaction setters only stage their value, see below */
+static bool
+config_stage(struct libinput_device *device, enum config_field field)
+{
+	if (!device->txn.open)
+		return false;
+
+	device->txn.staged |= bit(field);
+	return true;
+}
+
+static bool
+config_is_staged(struct libinput_device *device, enum config_field field)
+{
+	return device->txn.staged & bit(field);
+}
+
 LIBINPUT_EXPORT uint32_t
 libinput_device_config_send_events_get_modes(struct libinput_device *device)
 {
-	return LIBINPUT_CONFIG_STATUS_UNSUPPORTED;
+	uint32_t modes = LIBINPUT_CONFIG_SEND_EVENTS_DISABLED;
+
+	if (wscons_device_is_touchpad(device))
+		modes |= LIBINPUT_CONFIG_SEND_EVENTS_DISABLED_ON_EXTERNAL_MOUSE;
+
+	return modes;
 }
 
 LIBINPUT_EXPORT enum libinput_config_status
 libinput_device_config_send_events_set_mode(struct libinput_device *device,
 	uint32_t mode)
 {
+	if ((libinput_device_config_send_events_get_modes(device) & mode) != mode)
+		return LIBINPUT_CONFIG_STATUS_UNSUPPORTED;
+
+	if (config_stage(device, CONFIG_SEND_EVENTS)) {
+		device->txn.sendevents_mode = mode;
+		return LIBINPUT_CONFIG_STATUS_SUCCESS;
+	}
+
+	device->sendevents_mode = mode;
+	wscons_device_update_send_events(device);
+
 	return LIBINPUT_CONFIG_STATUS_SUCCESS;
 }
 
 LIBINPUT_EXPORT uint32_t
 libinput_device_config_send_events_get_mode(struct libinput_device *device)
 {
-	return LIBINPUT_CONFIG_SEND_EVENTS_ENABLED;
+	if (config_is_staged(device, CONFIG_SEND_EVENTS))
+		return device->txn.sendevents_mode;
+
+	return device->sendevents_mode;
 }
 
 LIBINPUT_EXPORT uint32_t
@@ -1848,7 +2679,8 @@ libinput_device_config_send_events_get_default_mode(struct libinput_device *devi
 LIBINPUT_EXPORT int
 libinput_device_config_accel_is_available(struct libinput_device *device)
 {
-	return 0;
+	return libinput_device_has_capability(device,
+					      LIBINPUT_DEVICE_CAP_POINTER);
 }
 
 LIBINPUT_EXPORT enum libinput_config_status
@@ -1859,13 +2691,37 @@ libinput_device_config_accel_set_speed(struct libinput_device *device,
 	if (!(speed >= -1.0 && speed <= 1.0))
 		return LIBINPUT_CONFIG_STATUS_INVALID;
 
-	return LIBINPUT_CONFIG_STATUS_UNSUPPORTED;
+	if (!libinput_device_config_accel_is_available(device))
+		return LIBINPUT_CONFIG_STATUS_UNSUPPORTED;
+
+	if (config_stage(device, CONFIG_ACCEL_SPEED)) {
+		device->txn.accel_speed = speed;
+		return LIBINPUT_CONFIG_STATUS_SUCCESS;
+	}
+
+	device->accel.speed = speed;
+	device->accel.dirty = true;
+
+	return LIBINPUT_CONFIG_STATUS_SUCCESS;
 }
 
 LIBINPUT_EXPORT double
 libinput_device_config_accel_get_speed(struct libinput_device *device)
 {
-	return 0;
+	if (config_is_staged(device, CONFIG_ACCEL_SPEED))
+		return device->txn.accel_speed;
+
+	return device->accel.speed;
+}
+
+LIBINPUT_EXPORT uint32_t
+libinput_device_config_accel_get_profiles(struct libinput_device *device)
+{
+	if (!libinput_device_config_accel_is_available(device))
+		return 0;
+
+	return LIBINPUT_CONFIG_ACCEL_PROFILE_FLAT |
+	       LIBINPUT_CONFIG_ACCEL_PROFILE_ADAPTIVE;
 }
 
 LIBINPUT_EXPORT double
@@ -1999,6 +2855,9 @@ libinput_device_config_middle_emulation_get_default_enabled(
 LIBINPUT_EXPORT uint32_t
 libinput_device_config_scroll_get_methods(struct libinput_device *device)
 {
+	if (wscons_device_is_touchpad(device))
+		return LIBINPUT_CONFIG_SCROLL_2FG | LIBINPUT_CONFIG_SCROLL_EDGE;
+
 	return 0;
 }
 
@@ -2017,13 +2876,30 @@ libinput_device_config_scroll_set_method(struct libinput_device *device,
 		return LIBINPUT_CONFIG_STATUS_INVALID;
 	}
 
-	return LIBINPUT_CONFIG_STATUS_UNSUPPORTED;
+	if (method != LIBINPUT_CONFIG_SCROLL_NO_SCROLL &&
+	    !(libinput_device_config_scroll_get_methods(device) & method))
+		return LIBINPUT_CONFIG_STATUS_UNSUPPORTED;
+
+	if (config_stage(device, CONFIG_SCROLL_METHOD)) {
+		device->txn.scroll_method = method;
+		return LIBINPUT_CONFIG_STATUS_SUCCESS;
+	}
+
+	if (method != device->tp.method) {
+		device->tp.method = method;
+		tp_update_mode(device);
+	}
+
+	return LIBINPUT_CONFIG_STATUS_SUCCESS;
 }
 
 LIBINPUT_EXPORT enum libinput_config_scroll_method
 libinput_device_config_scroll_get_method(struct libinput_device *device)
 {
-	return LIBINPUT_CONFIG_SCROLL_NO_SCROLL;
+	if (config_is_staged(device, CONFIG_SCROLL_METHOD))
+		return device->txn.scroll_method;
+
+	return device->tp.method;
 }
 
 LIBINPUT_EXPORT enum libinput_config_scroll_method
@@ -2083,38 +2959,143 @@ libinput_device_config_dwt_get_default_enabled(struct libinput_device *device)
 LIBINPUT_EXPORT int
 libinput_device_tablet_pad_get_num_buttons(struct libinput_device *device)
 {
-	return 0;
+	if (!libinput_device_has_capability(device,
+					    LIBINPUT_DEVICE_CAP_TABLET_PAD))
+		return -1;
+
+	return device->pad.nbuttons;
 }
 
 LIBINPUT_EXPORT int
 libinput_device_tablet_pad_get_num_rings(struct libinput_device *device)
 {
-	return 0;
+	if (!libinput_device_has_capability(device,
+					    LIBINPUT_DEVICE_CAP_TABLET_PAD))
+		return -1;
+
+	return device->pad.nrings;
 }
 
 LIBINPUT_EXPORT int
 libinput_device_tablet_pad_get_num_strips(struct libinput_device *device)
 {
-	return 0;
+	if (!libinput_device_has_capability(device,
+					    LIBINPUT_DEVICE_CAP_TABLET_PAD))
+		return -1;
+
+	return device->pad.nstrips;
 }
 
 LIBINPUT_EXPORT int
 libinput_device_tablet_pad_get_num_mode_groups(struct libinput_device *device)
 {
-	return 0;
+	if (!libinput_device_has_capability(device,
+					    LIBINPUT_DEVICE_CAP_TABLET_PAD))
+		return -1;
+
+	return 1;
 }
 
 LIBINPUT_EXPORT struct libinput_tablet_pad_mode_group*
 libinput_device_tablet_pad_get_mode_group(struct libinput_device *device,
 					  unsigned int index)
 {
-	return NULL;
+	if (!libinput_device_has_capability(device,
+					    LIBINPUT_DEVICE_CAP_TABLET_PAD) ||
+	    index != 0)
+		return NULL;
+
+	return &device->pad.group;
+}
+
+LIBINPUT_EXPORT unsigned int
+libinput_tablet_pad_mode_group_get_index(struct libinput_tablet_pad_mode_group *group)
+{
+	return group->index;
+}
+
+LIBINPUT_EXPORT unsigned int
+libinput_tablet_pad_mode_group_get_num_modes(struct libinput_tablet_pad_mode_group *group)
+{
+	return group->num_modes;
 }
 
 LIBINPUT_EXPORT unsigned int
 libinput_tablet_pad_mode_group_get_mode(struct libinput_tablet_pad_mode_group *group)
 {
-	return 0;
+	return group->mode;
+}
+
+LIBINPUT_EXPORT int
+libinput_tablet_pad_mode_group_has_button(struct libinput_tablet_pad_mode_group *group,
+					  unsigned int button)
+{
+	return button < PAD_MAX_BUTTONS && (group->buttons & bit(button));
+}
+
+LIBINPUT_EXPORT int
+libinput_tablet_pad_mode_group_has_ring(struct libinput_tablet_pad_mode_group *group,
+					  unsigned int ring)
+{
+	return ring < PAD_MAX_RINGS && (group->rings & bit(ring));
+}
+
+LIBINPUT_EXPORT int
+libinput_tablet_pad_mode_group_has_strip(struct libinput_tablet_pad_mode_group *group,
+					  unsigned int strip)
+{
+	return strip < PAD_MAX_STRIPS && (group->strips & bit(strip));
+}
+
+LIBINPUT_EXPORT int
+libinput_tablet_pad_mode_group_button_is_toggle(struct libinput_tablet_pad_mode_group *group,
+						unsigned int button)
+{
+	return button < PAD_MAX_BUTTONS && (group->toggles & bit(button));
+}
+
+/*
+ * Groups are part of their pad, a reference on the group keeps the whole
+ * device alive.
+ */
+LIBINPUT_EXPORT struct libinput_tablet_pad_mode_group *
+libinput_tablet_pad_mode_group_ref(
+			struct libinput_tablet_pad_mode_group *group)
+{
+	group->refcount++;
+	libinput_device_ref(group->device);
+
+	return group;
+}
+
+LIBINPUT_EXPORT struct libinput_tablet_pad_mode_group *
+libinput_tablet_pad_mode_group_unref(
+			struct libinput_tablet_pad_mode_group *group)
+{
+	bool last;
+
+	assert(group->refcount > 0);
+
+	last = --group->refcount == 0;
+	if (libinput_device_unref(group->device) == NULL || last)
+		return NULL;
+
+	return group;
+}
+
+LIBINPUT_EXPORT void
+libinput_tablet_pad_mode_group_set_user_data(
+			struct libinput_tablet_pad_mode_group *group,
+			void *user_data)
+{
+	group->user_data = user_data;
+}
+
+LIBINPUT_EXPORT void *
+libinput_tablet_pad_mode_group_get_user_data(
+			struct libinput_tablet_pad_mode_group *group)
+{
+	return group->user_data;
 }
 
 
@@ -2174,19 +3155,67 @@ libinput_tablet_tool_has_wheel(struct libinput_tablet_tool *tool)
 LIBINPUT_EXPORT double
 libinput_event_tablet_pad_get_ring_position(struct libinput_event_tablet_pad *event)
 {
-	return 0;
+	require_event_type(libinput_event_get_context(&event->base),
+			   event->base.type,
+			   0.0,
+			   LIBINPUT_EVENT_TABLET_PAD_RING);
+
+	return event->ring.position;
 }
 
 LIBINPUT_EXPORT unsigned int
 libinput_event_tablet_pad_get_ring_number(struct libinput_event_tablet_pad *event)
 {
-	return 0;
+	require_event_type(libinput_event_get_context(&event->base),
+			   event->base.type,
+			   0,
+			   LIBINPUT_EVENT_TABLET_PAD_RING);
+
+	return event->ring.number;
 }
 
 LIBINPUT_EXPORT enum libinput_tablet_pad_ring_axis_source
 libinput_event_tablet_pad_get_ring_source(struct libinput_event_tablet_pad *event)
 {
-	return LIBINPUT_TABLET_PAD_RING_SOURCE_UNKNOWN;
+	require_event_type(libinput_event_get_context(&event->base),
+			   event->base.type,
+			   LIBINPUT_TABLET_PAD_RING_SOURCE_UNKNOWN,
+			   LIBINPUT_EVENT_TABLET_PAD_RING);
+
+	return event->ring.source;
+}
+
+LIBINPUT_EXPORT double
+libinput_event_tablet_pad_get_strip_position(struct libinput_event_tablet_pad *event)
+{
+	require_event_type(libinput_event_get_context(&event->base),
+			   event->base.type,
+			   0.0,
+			   LIBINPUT_EVENT_TABLET_PAD_STRIP);
+
+	return event->strip.position;
+}
+
+LIBINPUT_EXPORT unsigned int
+libinput_event_tablet_pad_get_strip_number(struct libinput_event_tablet_pad *event)
+{
+	require_event_type(libinput_event_get_context(&event->base),
+			   event->base.type,
+			   0,
+			   LIBINPUT_EVENT_TABLET_PAD_STRIP);
+
+	return event->strip.number;
+}
+
+LIBINPUT_EXPORT enum libinput_tablet_pad_strip_axis_source
+libinput_event_tablet_pad_get_strip_source(struct libinput_event_tablet_pad *event)
+{
+	require_event_type(libinput_event_get_context(&event->base),
+			   event->base.type,
+			   LIBINPUT_TABLET_PAD_STRIP_SOURCE_UNKNOWN,
+			   LIBINPUT_EVENT_TABLET_PAD_STRIP);
+
+	return event->strip.source;
 }
 
 LIBINPUT_EXPORT double
@@ -2300,62 +3329,194 @@ libinput_event_tablet_tool_get_button_state(struct libinput_event_tablet_tool *e
 LIBINPUT_EXPORT uint32_t
 libinput_event_tablet_pad_get_button_number(struct libinput_event_tablet_pad *event)
 {
-	return 0;
+	require_event_type(libinput_event_get_context(&event->base),
+			   event->base.type,
+			   0,
+			   LIBINPUT_EVENT_TABLET_PAD_BUTTON);
+
+	return event->button.number;
 }
 
 LIBINPUT_EXPORT enum libinput_button_state
 libinput_event_tablet_pad_get_button_state(struct libinput_event_tablet_pad *event)
 {
-	return 0;
+	require_event_type(libinput_event_get_context(&event->base),
+			   event->base.type,
+			   LIBINPUT_BUTTON_STATE_RELEASED,
+			   LIBINPUT_EVENT_TABLET_PAD_BUTTON);
+
+	return event->button.state;
 }
 
 LIBINPUT_EXPORT uint32_t
 libinput_event_tablet_pad_get_key(struct libinput_event_tablet_pad *event)
 {
-	return 0;
+	require_event_type(libinput_event_get_context(&event->base),
+			   event->base.type,
+			   0,
+			   LIBINPUT_EVENT_TABLET_PAD_KEY);
+
+	return event->key.code;
 }
 
 LIBINPUT_EXPORT enum libinput_key_state
 libinput_event_tablet_pad_get_key_state(struct libinput_event_tablet_pad *event)
 {
-	return 0;
+	require_event_type(libinput_event_get_context(&event->base),
+			   event->base.type,
+			   LIBINPUT_KEY_STATE_RELEASED,
+			   LIBINPUT_EVENT_TABLET_PAD_KEY);
+
+	return event->key.state;
 }
 
 LIBINPUT_EXPORT unsigned int
 libinput_event_tablet_pad_get_mode(struct libinput_event_tablet_pad *event)
 {
-	return 0;
+	require_event_type(libinput_event_get_context(&event->base),
+			   event->base.type,
+			   0,
+			   LIBINPUT_EVENT_TABLET_PAD_RING,
+			   LIBINPUT_EVENT_TABLET_PAD_STRIP,
+			   LIBINPUT_EVENT_TABLET_PAD_BUTTON);
+
+	return event->mode;
 }
 
 LIBINPUT_EXPORT struct libinput_tablet_pad_mode_group *
 libinput_event_tablet_pad_get_mode_group(struct libinput_event_tablet_pad *event)
 {
-	return 0;
+	require_event_type(libinput_event_get_context(&event->base),
+			   event->base.type,
+			   NULL,
+			   LIBINPUT_EVENT_TABLET_PAD_RING,
+			   LIBINPUT_EVENT_TABLET_PAD_STRIP,
+			   LIBINPUT_EVENT_TABLET_PAD_BUTTON);
+
+	return event->mode_group;
 }
 
 LIBINPUT_EXPORT uint32_t
 libinput_event_tablet_pad_get_time(struct libinput_event_tablet_pad *event)
 {
-	return 0;
+	require_event_type(libinput_event_get_context(&event->base),
+			   event->base.type,
+			   0,
+			   LIBINPUT_EVENT_TABLET_PAD_RING,
+			   LIBINPUT_EVENT_TABLET_PAD_STRIP,
+			   LIBINPUT_EVENT_TABLET_PAD_BUTTON,
+			   LIBINPUT_EVENT_TABLET_PAD_KEY);
+
+	return us2ms(event->time);
 }
 
 LIBINPUT_EXPORT uint64_t
 libinput_event_tablet_pad_get_time_usec(struct libinput_event_tablet_pad *event)
 {
-	return 0;
+	require_event_type(libinput_event_get_context(&event->base),
+			   event->base.type,
+			   0,
+			   LIBINPUT_EVENT_TABLET_PAD_RING,
+			   LIBINPUT_EVENT_TABLET_PAD_STRIP,
+			   LIBINPUT_EVENT_TABLET_PAD_BUTTON,
+			   LIBINPUT_EVENT_TABLET_PAD_KEY);
+
+	return event->time;
 }
 
 LIBINPUT_EXPORT struct libinput_event *
 libinput_event_tablet_pad_get_base_event(struct libinput_event_tablet_pad *event)
 {
-	return 0;
+	require_event_type(libinput_event_get_context(&event->base),
+			   event->base.type,
+			   NULL,
+			   LIBINPUT_EVENT_TABLET_PAD_RING,
+			   LIBINPUT_EVENT_TABLET_PAD_STRIP,
+			   LIBINPUT_EVENT_TABLET_PAD_BUTTON,
+			   LIBINPUT_EVENT_TABLET_PAD_KEY);
+
+	return &event->base;
+}
+
+LIBINPUT_EXPORT enum libinput_switch
+libinput_event_switch_get_switch(struct libinput_event_switch *event)
+{
+	require_event_type(libinput_event_get_context(&event->base),
+			   event->base.type,
+			   0,
+			   LIBINPUT_EVENT_SWITCH_TOGGLE);
+
+	return event->sw;
+}
+
+LIBINPUT_EXPORT enum libinput_switch_state
+libinput_event_switch_get_switch_state(struct libinput_event_switch *event)
+{
+	require_event_type(libinput_event_get_context(&event->base),
+			   event->base.type,
+			   0,
+			   LIBINPUT_EVENT_SWITCH_TOGGLE);
+
+	return event->state;
+}
+
+LIBINPUT_EXPORT struct libinput_event *
+libinput_event_switch_get_base_event(struct libinput_event_switch *event)
+{
+	require_event_type(libinput_event_get_context(&event->base),
+			   event->base.type,
+			   NULL,
+			   LIBINPUT_EVENT_SWITCH_TOGGLE);
+
+	return &event->base;
+}
+
+LIBINPUT_EXPORT uint32_t
+libinput_event_switch_get_time(struct libinput_event_switch *event)
+{
+	require_event_type(libinput_event_get_context(&event->base),
+			   event->base.type,
+			   0,
+			   LIBINPUT_EVENT_SWITCH_TOGGLE);
+
+	return us2ms(event->time);
+}
+
+LIBINPUT_EXPORT uint64_t
+libinput_event_switch_get_time_usec(struct libinput_event_switch *event)
+{
+	require_event_type(libinput_event_get_context(&event->base),
+			   event->base.type,
+			   0,
+			   LIBINPUT_EVENT_SWITCH_TOGGLE);
+
+	return event->time;
 }
 
 LIBINPUT_EXPORT enum libinput_config_status
 libinput_device_config_accel_set_profile(struct libinput_device *device,
 					 enum libinput_config_accel_profile profile)
 {
-	return 0;
+	switch (profile) {
+	case LIBINPUT_CONFIG_ACCEL_PROFILE_FLAT:
+	case LIBINPUT_CONFIG_ACCEL_PROFILE_ADAPTIVE:
+		break;
+	default:
+		return LIBINPUT_CONFIG_STATUS_INVALID;
+	}
+
+	if (!(libinput_device_config_accel_get_profiles(device) & profile))
+		return LIBINPUT_CONFIG_STATUS_UNSUPPORTED;
+
+	if (config_stage(device, CONFIG_ACCEL_PROFILE)) {
+		device->txn.accel_profile = profile;
+		return LIBINPUT_CONFIG_STATUS_SUCCESS;
+	}
+
+	device->accel.profile = profile;
+	device->accel.dirty = true;
+
+	return LIBINPUT_CONFIG_STATUS_SUCCESS;
 }
 
 LIBINPUT_EXPORT enum libinput_config_status
@@ -2376,6 +3537,16 @@ LIBINPUT_EXPORT int
 libinput_device_switch_has_switch(struct libinput_device *device,
 				  enum libinput_switch sw)
 {
+	if (!libinput_device_has_capability(device,
+					    LIBINPUT_DEVICE_CAP_SWITCH))
+		return -1;
+
+	switch (sw) {
+	case LIBINPUT_SWITCH_LID:
+	case LIBINPUT_SWITCH_TABLET_MODE:
+		return !!(device->sw.available & bit(sw));
+	}
+
 	return 0;
 }
 
@@ -2400,7 +3571,13 @@ libinput_device_config_tap_get_drag_enabled(struct libinput_device *device)
 LIBINPUT_EXPORT enum libinput_config_accel_profile
 libinput_device_config_accel_get_profile(struct libinput_device *device)
 {
-	return 0;
+	if (!libinput_device_config_accel_is_available(device))
+		return LIBINPUT_CONFIG_ACCEL_PROFILE_NONE;
+
+	if (config_is_staged(device, CONFIG_ACCEL_PROFILE))
+		return device->txn.accel_profile;
+
+	return device->accel.profile;
 }
 
 LIBINPUT_EXPORT enum libinput_config_scroll_button_lock_state
@@ -2421,24 +3598,172 @@ libinput_device_config_dwtp_get_enabled(struct libinput_device *device)
 	return LIBINPUT_CONFIG_DWTP_DISABLED;
 }
 
+LIBINPUT_EXPORT int
+libinput_device_config_abs_to_rel_is_available(struct libinput_device *device)
+{
+	return libinput_device_has_capability(device,
+					      LIBINPUT_DEVICE_CAP_POINTER) &&
+	       device->abs.valid;
+}
+
+LIBINPUT_EXPORT enum libinput_config_status
+libinput_device_config_abs_to_rel_set_enabled(struct libinput_device *device,
+    enum libinput_config_abs_to_rel_state state)
+{
+	switch (state) {
+	case LIBINPUT_CONFIG_ABS_TO_REL_DISABLED:
+		break;
+	case LIBINPUT_CONFIG_ABS_TO_REL_ENABLED:
+		if (!libinput_device_config_abs_to_rel_is_available(device))
+			return LIBINPUT_CONFIG_STATUS_UNSUPPORTED;
+		break;
+	default:
+		return LIBINPUT_CONFIG_STATUS_INVALID;
+	}
+
+	if (config_stage(device, CONFIG_ABS_TO_REL)) {
+		device->txn.abs_to_rel =
+			state == LIBINPUT_CONFIG_ABS_TO_REL_ENABLED;
+		return LIBINPUT_CONFIG_STATUS_SUCCESS;
+	}
+
+	device->abs_to_rel.enabled = state == LIBINPUT_CONFIG_ABS_TO_REL_ENABLED;
+	device->abs_to_rel.valid[0] = false;
+	device->abs_to_rel.valid[1] = false;
+
+	return LIBINPUT_CONFIG_STATUS_SUCCESS;
+}
+
+LIBINPUT_EXPORT enum libinput_config_abs_to_rel_state
+libinput_device_config_abs_to_rel_get_enabled(struct libinput_device *device)
+{
+	if (config_is_staged(device, CONFIG_ABS_TO_REL))
+		return device->txn.abs_to_rel ?
+			LIBINPUT_CONFIG_ABS_TO_REL_ENABLED :
+			LIBINPUT_CONFIG_ABS_TO_REL_DISABLED;
+
+	return device->abs_to_rel.enabled ?
+		LIBINPUT_CONFIG_ABS_TO_REL_ENABLED :
+		LIBINPUT_CONFIG_ABS_TO_REL_DISABLED;
+}
+
+LIBINPUT_EXPORT enum libinput_config_abs_to_rel_state
+libinput_device_config_abs_to_rel_get_default_enabled(struct libinput_device *device)
+{
+	return LIBINPUT_CONFIG_ABS_TO_REL_DISABLED;
+}
+
 LIBINPUT_EXPORT int
 libinput_device_config_rotation_is_available(struct libinput_device *device)
 {
-	return 0;
+	return libinput_device_has_capability(device,
+					      LIBINPUT_DEVICE_CAP_POINTER);
 }
 
 LIBINPUT_EXPORT unsigned int
 libinput_device_config_rotation_get_angle(struct libinput_device *device)
 {
-	return 0;
+	if (config_is_staged(device, CONFIG_ROTATION))
+		return device->txn.rotation;
+
+	return device->rotation.angle;
 }
 
 LIBINPUT_EXPORT enum libinput_config_status
 libinput_device_config_rotation_set_angle(struct libinput_device *device,
     unsigned int  degrees)
 {
-	return LIBINPUT_CONFIG_STATUS_UNSUPPORTED;
+	if (!libinput_device_config_rotation_is_available(device))
+		return degrees ? LIBINPUT_CONFIG_STATUS_UNSUPPORTED :
+				 LIBINPUT_CONFIG_STATUS_SUCCESS;
+
+	if (degrees >= 360)
+		return LIBINPUT_CONFIG_STATUS_INVALID;
+
+	if (config_stage(device, CONFIG_ROTATION)) {
+		device->txn.rotation = degrees;
+		return LIBINPUT_CONFIG_STATUS_SUCCESS;
+	}
+
+	/* sin/cos are only computed here, never per event */
+	device->rotation.angle = degrees;
+	matrix_init_rotate(&device->rotation.matrix, degrees);
+
+	return LIBINPUT_CONFIG_STATUS_SUCCESS;
 }
+
+LIBINPUT_EXPORT int
+libinput_device_config_begin(struct libinput_device *device)
+{
+	if (device->txn.open)
+		return -EBUSY;
+
+	device->txn.open = true;
+	device->txn.staged = 0;
+
+	return 0;
+}
+
+/*
+ * Apply the staged settings in one go. Motion is rotated and accelerated
+ * when its frame is posted, so every frame sees either the old or the new
+ * settings, and the acceleration table is rebuilt once for all of them.
+ */
+LIBINPUT_EXPORT int
+libinput_device_config_commit(struct libinput_device *device)
+{
+	uint32_t staged = device->txn.staged;
+
+	if (!device->txn.open)
+		return -EINVAL;
+
+	device->txn.open = false;
+	device->txn.staged = 0;
+
+	if (staged & bit(CONFIG_ROTATION)) {
+		device->rotation.angle = device->txn.rotation;
+		matrix_init_rotate(&device->rotation.matrix,
+				   device->txn.rotation);
+	}
+
+	if (staged & bit(CONFIG_ABS_TO_REL)) {
+		device->abs_to_rel.enabled = device->txn.abs_to_rel;
+		device->abs_to_rel.valid[0] = false;
+		device->abs_to_rel.valid[1] = false;
+	}
+
+	/* Before the table, the mode selects the curve */
+	if ((staged & bit(CONFIG_SCROLL_METHOD)) &&
+	    device->txn.scroll_method != device->tp.method) {
+		device->tp.method = device->txn.scroll_method;
+		tp_update_mode(device);
+	}
+
+	if (staged & bit(CONFIG_ACCEL_SPEED))
+		device->accel.speed = device->txn.accel_speed;
+	if (staged & bit(CONFIG_ACCEL_PROFILE))
+		device->accel.profile = device->txn.accel_profile;
+	if (staged & (bit(CONFIG_ACCEL_SPEED) | bit(CONFIG_ACCEL_PROFILE))) {
+		device->accel.dirty = true;
+		filter_configure(device);
+	}
+
+	/* Last, it may close the device */
+	if (staged & bit(CONFIG_SEND_EVENTS)) {
+		device->sendevents_mode = device->txn.sendevents_mode;
+		wscons_device_update_send_events(device);
+	}
+
+	return 0;
+}
+
+LIBINPUT_EXPORT void
+libinput_device_config_abort(struct libinput_device *device)
+{
+	device->txn.open = false;
+	device->txn.staged = 0;
+}
+
 LIBINPUT_EXPORT enum libinput_config_status
 libinput_device_config_scroll_set_button_lock(struct libinput_device *device,
     enum libinput_config_scroll_button_lock_state state)
@@ -2468,7 +3793,10 @@ libinput_device_config_rotation_get_default_angle(struct libinput_device *device
 LIBINPUT_EXPORT enum libinput_config_accel_profile
 libinput_device_config_accel_get_default_profile(struct libinput_device *device)
 {
-	return LIBINPUT_CONFIG_ACCEL_PROFILE_NONE;
+	if (!libinput_device_config_accel_is_available(device))
+		return LIBINPUT_CONFIG_ACCEL_PROFILE_NONE;
+
+	return LIBINPUT_CONFIG_ACCEL_PROFILE_ADAPTIVE;
 }
 
 LIBINPUT_EXPORT enum libinput_config_dwtp_state
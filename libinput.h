@@ -190,6 +190,11 @@ enum libinput_log_priority {
  *
  * Capabilities on a device. A device may have one or more capabilities
  * at a time, capabilities remain static for the lifetime of the device.
+ *
+ * The one exception is @ref LIBINPUT_DEVICE_CAP_GESTURE. Hold gestures
+ * need the touchpad in native mode, so a touchpad only has this
+ * capability while its scroll method is not @ref
+ * LIBINPUT_CONFIG_SCROLL_NO_SCROLL, the default.
  */
 enum libinput_device_capability {
 	LIBINPUT_DEVICE_CAP_KEYBOARD = 0,
@@ -978,6 +983,10 @@ enum libinput_event_type {
 	LIBINPUT_EVENT_GESTURE_PINCH_UPDATE,
 	LIBINPUT_EVENT_GESTURE_PINCH_END,
 	/**
+	 * Only posted by a touchpad with the @ref
+	 * LIBINPUT_DEVICE_CAP_GESTURE capability, i.e. while its scroll
+	 * method is not @ref LIBINPUT_CONFIG_SCROLL_NO_SCROLL.
+	 *
 	 * @since 1.19
 	 */
 	LIBINPUT_EVENT_GESTURE_HOLD_BEGIN,
@@ -996,18 +1005,53 @@ enum libinput_event_type {
 /**
  * @ingroup event
  *
- * Destroy the event, freeing all associated resources. Resources obtained
- * from this event must be considered invalid after this call.
- *
- * @warning Unlike other structs events are considered transient and
- * <b>not</b> refcounted. Calling libinput_event_destroy() <b>will</b>
- * destroy the event.
+ * Release the caller's reference to the event, see libinput_event_unref().
+ * Resources obtained from this event must be considered invalid after this
+ * call unless the caller took another reference.
  *
  * @param event An event retrieved by libinput_get_event().
  */
 void
 libinput_event_destroy(struct libinput_event *event);
 
+/**
+ * @ingroup event
+ *
+ * Add a reference to the event. An event returned by libinput_get_event()
+ * holds one reference owned by the caller, each further holder takes its
+ * own so the event can be passed around without copying it.
+ *
+ * Like the rest of the API this is not thread-safe, all holders must call
+ * it from the thread using the libinput context. All references must be
+ * released before the context is destroyed.
+ *
+ * @param event A previously obtained event
+ * @return The passed event
+ *
+ * @see libinput_event_unref
+ *
+ * @since 1.22
+ */
+struct libinput_event *
+libinput_event_ref(struct libinput_event *event);
+
+/**
+ * @ingroup event
+ *
+ * Drop a reference to the event. Once the last reference is dropped the
+ * event is returned to the context and its memory reused for later
+ * events.
+ *
+ * @param event A previously obtained event, or NULL
+ * @return NULL if the event was released, otherwise the passed event
+ *
+ * @see libinput_event_ref
+ *
+ * @since 1.22
+ */
+struct libinput_event *
+libinput_event_unref(struct libinput_event *event);
+
 /**
  * @ingroup event
  *
@@ -1169,6 +1213,124 @@ libinput_event_get_device_notify_event(struct libinput_event *event);
 struct libinput_event *
 libinput_event_device_notify_get_base_event(struct libinput_event_device_notify *event);
 
+/**
+ * @ingroup event
+ * @struct libinput_event_record
+ *
+ * The fields of an event as plain data, filled in by
+ * libinput_event_get_record(). Only the member of the union matching the
+ * event type is set, the union is zeroed for all other event types.
+ * Tablet pad events only fill in the time, use the tablet pad accessor
+ * functions for their button, ring, strip and key data.
+ *
+ * Fields are only ever appended to this struct and the union never grows
+ * beyond its current size, so a caller built against an older version of
+ * this struct keeps working with a newer library and vice versa.
+ *
+ * @since 1.22
+ */
+struct libinput_event_record {
+	/** The number of bytes filled in by libinput_event_get_record() */
+	uint32_t size;
+	enum libinput_event_type type;
+	struct libinput_device *device;
+	/** Event time in microseconds, 0 for events without a time */
+	uint64_t time;
+
+	union {
+		/** @ref LIBINPUT_EVENT_KEYBOARD_KEY */
+		struct {
+			uint32_t key;
+			enum libinput_key_state state;
+			uint32_t seat_key_count;
+			uint32_t keysym;
+		} keyboard;
+
+		/** @ref LIBINPUT_EVENT_POINTER_MOTION */
+		struct {
+			double dx;
+			double dy;
+			double dx_unaccelerated;
+			double dy_unaccelerated;
+		} motion;
+
+		/** @ref LIBINPUT_EVENT_POINTER_BUTTON */
+		struct {
+			uint32_t button;
+			enum libinput_button_state state;
+			uint32_t seat_button_count;
+		} button;
+
+		/**
+		 * @ref LIBINPUT_EVENT_POINTER_SCROLL_WHEEL, @ref
+		 * LIBINPUT_EVENT_POINTER_SCROLL_FINGER and @ref
+		 * LIBINPUT_EVENT_POINTER_SCROLL_CONTINUOUS. The arrays are
+		 * indexed by @ref libinput_pointer_axis, only the axes set in
+		 * the axes bitmask are valid.
+		 */
+		struct {
+			uint32_t axes;
+			double value[2];
+			double value_v120[2];
+		} scroll;
+
+		/**
+		 * @ref LIBINPUT_EVENT_GESTURE_HOLD_BEGIN and @ref
+		 * LIBINPUT_EVENT_GESTURE_HOLD_END
+		 */
+		struct {
+			int finger_count;
+			int cancelled;
+		} gesture;
+
+		/**
+		 * @ref LIBINPUT_EVENT_TOUCH_DOWN, @ref LIBINPUT_EVENT_TOUCH_UP,
+		 * @ref LIBINPUT_EVENT_TOUCH_MOTION, @ref
+		 * LIBINPUT_EVENT_TOUCH_CANCEL and @ref
+		 * LIBINPUT_EVENT_TOUCH_FRAME. The slots are -1 for a frame
+		 * event, use libinput_event_touch_get_x() and friends for the
+		 * coordinates.
+		 */
+		struct {
+			int32_t slot;
+			int32_t seat_slot;
+		} touch;
+
+		/** @ref LIBINPUT_EVENT_SWITCH_TOGGLE */
+		struct {
+			enum libinput_switch sw;
+			enum libinput_switch_state state;
+		} sw;
+
+		uint64_t reserved[8];
+	} u;
+};
+
+/**
+ * @ingroup event
+ *
+ * Copy the type, device, time and type-specific fields of this event into
+ * a caller-provided record in a single call, instead of calling the
+ * individual accessor functions.
+ *
+ * The size argument is the size of the caller's struct @ref
+ * libinput_event_record, i.e. sizeof(*record). libinput fills in at most
+ * that many bytes, a caller built against an older and smaller version of
+ * the struct only receives the fields it knows about.
+ *
+ * @param event The libinput event
+ * @param record The record to fill in
+ * @param size The size of the record in bytes
+ * @return The number of bytes filled in, or -EINVAL if size is too small
+ * to hold the type, device and time of the event
+ *
+ * @since 1.22
+ */
+int
+libinput_event_get_record(struct libinput_event *event,
+			  struct libinput_event_record *record,
+			  size_t size);
+
 /**
  * @defgroup event_keyboard Keyboard events
  *
@@ -1238,6 +1400,30 @@ uint32_t
 libinput_event_keyboard_get_seat_key_count(
 	struct libinput_event_keyboard *event);
 
+/**
+ * @ingroup event_keyboard
+ *
+ * Return the keysym the key of this event produces in the keyboard layout
+ * of the device, taking into account the shift, group switch (AltGr) and
+ * caps lock keys pressed on the same device before this event.
+ *
+ * Keysyms are those of wscons(4), see dev/wscons/wsksymdef.h. Printable
+ * characters of the ISO 8859-1 range have the character code as keysym.
+ * The lookup was done when the event was read, so this call is cheap.
+ *
+ * @note It is an application bug to call this function for events other than
+ * @ref LIBINPUT_EVENT_KEYBOARD_KEY. For other events, this function returns 0.
+ *
+ * @return The keysym of the key, or 0 if the key has no keysym or the
+ * layout of the device is unknown
+ *
+ * @see libinput_set_keymap_cache_dir
+ *
+ * @since 1.22
+ */
+uint32_t
+libinput_event_keyboard_get_keysym(struct libinput_event_keyboard *event);
+
 /**
  * @defgroup event_pointer Pointer events
  *
@@ -3868,6 +4054,248 @@ void
 libinput_log_set_handler(struct libinput *libinput,
 			 libinput_log_handler log_handler);
 
+/**
+ * @ingroup base
+ * @struct libinput_clock_interface
+ *
+ * A clock used by libinput for all time-dependent processing that is not
+ * driven by device timestamps, e.g. timers and log rate limiting.
+ *
+ * @see libinput_set_clock
+ *
+ * @since 1.22
+ */
+struct libinput_clock_interface {
+	/**
+	 * Return the current time in microseconds. The time must never
+	 * decrease.
+	 *
+	 * @param user_data The user_data provided in libinput_set_clock()
+	 */
+	uint64_t (*now)(void *user_data);
+};
+
+/**
+ * @ingroup base
+ *
+ * Replace the clock of this context. By default libinput uses
+ * CLOCK_MONOTONIC.
+ *
+ * With a caller-provided clock, libinput does not wait for timers on the
+ * file descriptor returned by libinput_get_fd(). Instead, timers that
+ * expired according to the clock are run on the next call to
+ * libinput_dispatch(). A test harness can thus advance a virtual clock and
+ * call libinput_dispatch() to have timers fire exactly as they would in
+ * real time, without waiting for them.
+ *
+ * The clock should be set before any device is added to the context.
+ * Changing it while timers are pending results in those timers expiring
+ * relative to the new clock.
+ *
+ * @param libinput A previously initialized libinput context
+ * @param clock The clock interface, or NULL to restore the default clock
+ * @param user_data Caller-specific data passed to the clock interface
+ *
+ * @since 1.22
+ */
+void
+libinput_set_clock(struct libinput *libinput,
+		   const struct libinput_clock_interface *clock,
+		   void *user_data);
+
+/**
+ * @ingroup base
+ *
+ * Start recording timing spans of the input pipeline (device reads,
+ * record decoding, frame assembly, event posting and dequeuing) into an
+ * in-memory ring buffer of the given number of spans. The buffer is
+ * allocated once by this call; recording itself does not allocate or
+ * lock. Once the buffer is full, the oldest spans are overwritten.
+ *
+ * Timestamps are taken from CLOCK_MONOTONIC so the trace can be lined up
+ * with other traces taken on the same machine.
+ *
+ * If tracing is already enabled, the previously recorded spans are
+ * discarded and a buffer of the new size is allocated.
+ *
+ * @param libinput A previously initialized libinput context
+ * @param num_spans The number of spans to keep, must be greater than 0
+ * @return 0 on success or a negative errno on failure
+ *
+ * @see libinput_trace_disable
+ * @see libinput_trace_dump
+ *
+ * @since 1.22
+ */
+int
+libinput_trace_enable(struct libinput *libinput, unsigned int num_spans);
+
+/**
+ * @ingroup base
+ *
+ * Stop recording timing spans and release the trace buffer. Any spans
+ * not yet dumped with libinput_trace_dump() are lost.
+ *
+ * @param libinput A previously initialized libinput context
+ *
+ * @see libinput_trace_enable
+ *
+ * @since 1.22
+ */
+void
+libinput_trace_disable(struct libinput *libinput);
+
+/**
+ * @ingroup base
+ *
+ * Write the spans currently held in the trace buffer to the given file
+ * descriptor in the Chrome trace event JSON format. The output can be
+ * loaded into chrome://tracing or the Perfetto UI. The trace buffer is
+ * not modified by this call.
+ *
+ * @param libinput A previously initialized libinput context
+ * @param fd A file descriptor open for writing
+ * @return 0 on success or a negative errno on failure. If tracing is not
+ * enabled, -EINVAL is returned.
+ *
+ * @see libinput_trace_enable
+ *
+ * @since 1.22
+ */
+int
+libinput_trace_dump(struct libinput *libinput, int fd);
+
+/**
+ * @ingroup base
+ *
+ * Start keeping the most recent raw records read from each device in a
+ * per-device ring buffer of the given number of records, for later
+ * inspection with libinput_flight_recorder_dump(). The buffers are
+ * allocated by this call and when a device is added; recording itself
+ * does not allocate and costs one memory copy per read from the device,
+ * so the recorder may be left enabled permanently. Memory use is bounded
+ * by the number of devices times num_records times the size of a record.
+ *
+ * If the flight recorder is already enabled, the previously recorded
+ * records are discarded and buffers of the new size are allocated.
+ *
+ * @param libinput A previously initialized libinput context
+ * @param num_records The number of records to keep per device, must be
+ * greater than 0
+ * @return 0 on success or a negative errno on failure
+ *
+ * @see libinput_flight_recorder_disable
+ * @see libinput_flight_recorder_dump
+ *
+ * @since 1.22
+ */
+int
+libinput_flight_recorder_enable(struct libinput *libinput,
+				unsigned int num_records);
+
+/**
+ * @ingroup base
+ *
+ * Stop the flight recorder and release its buffers.
+ *
+ * @param libinput A previously initialized libinput context
+ *
+ * @see libinput_flight_recorder_enable
+ *
+ * @since 1.22
+ */
+void
+libinput_flight_recorder_disable(struct libinput *libinput);
+
+/**
+ * @ingroup base
+ *
+ * Write the records currently held by the flight recorder of every device
+ * to the given file descriptor in a compact binary format, with
+ * delta-encoded timestamps and variable-length integers. The dump can be
+ * read back with libinput-measure -r. The recorded records are not
+ * modified by this call.
+ *
+ * This function is not async-signal-safe. A caller wanting to dump on a
+ * signal should note the signal in its handler and call this function
+ * from its main loop.
+ *
+ * @param libinput A previously initialized libinput context
+ * @param fd A file descriptor open for writing
+ * @return 0 on success or a negative errno on failure. If the flight
+ * recorder is not enabled, -EINVAL is returned.
+ *
+ * @see libinput_flight_recorder_enable
+ *
+ * @since 1.22
+ */
+int
+libinput_flight_recorder_dump(struct libinput *libinput, int fd);
+
+/**
+ * @ingroup base
+ *
+ * Set a directory where libinput stores the keyboard layouts it compiled
+ * into keysym lookup tables, see libinput_event_keyboard_get_keysym().
+ * Tables found in the directory are mapped read-only instead of being
+ * compiled, so processes using the same directory share them. A table is
+ * only used for the exact kernel keymap it was compiled from.
+ *
+ * The directory must exist and should only be writable by trusted users.
+ * It applies to keyboards opened after this call.
+ *
+ * @param libinput A previously initialized libinput context
+ * @param path The cache directory, or NULL to not cache keymaps
+ * @return 0 on success or a negative errno on failure
+ *
+ * @since 1.22
+ */
+int
+libinput_set_keymap_cache_dir(struct libinput *libinput, const char *path);
+
+/**
+ * @ingroup base
+ *
+ * Read the devices of this context from a dedicated thread that spins on
+ * non-blocking reads instead of waiting for kqueue to report them. This
+ * trades a CPU core for the wakeup latency of the kernel. After a long
+ * time without input the thread backs off to yielding and eventually to
+ * short sleeps.
+ *
+ * The records read are queued and decoded by libinput_dispatch(). The fd
+ * returned by libinput_get_fd() no longer becomes readable on device
+ * input, so the caller must call libinput_dispatch() in a loop of its
+ * own. Devices that do not fit into the thread's slots keep being read
+ * through kqueue.
+ *
+ * The time records spent in the kernel is reported by
+ * libinput_device_get_stats() in either mode.
+ *
+ * @param libinput A previously initialized libinput context
+ * @return 0 on success or a negative errno on failure
+ *
+ * @see libinput_busypoll_disable
+ *
+ * @since 1.22
+ */
+int
+libinput_busypoll_enable(struct libinput *libinput);
+
+/**
+ * @ingroup base
+ *
+ * Stop the busy-poll thread and read the devices through kqueue again.
+ * Records read by the thread but not yet decoded are processed first.
+ *
+ * @param libinput A previously initialized libinput context
+ *
+ * @see libinput_busypoll_enable
+ *
+ * @since 1.22
+ */
+void
+libinput_busypoll_disable(struct libinput *libinput);
+
 /**
  * @defgroup seat Initialization and manipulation of seats
  *
@@ -3974,6 +4402,69 @@ libinput_seat_get_physical_name(struct libinput_seat *seat);
 const char *
 libinput_seat_get_logical_name(struct libinput_seat *seat);
 
+/**
+ * @ingroup seat
+ *
+ * Return the time since the last input on any device of this seat, i.e.
+ * the last key, button, motion or scroll event. Before any input, the
+ * time since the seat was created is returned. Input is accounted for as
+ * it is read in libinput_dispatch(), whether or not the caller retrieves
+ * the events. Releases libinput posts itself, e.g. for a suspended
+ * device, are not input.
+ *
+ * @param seat A previously obtained seat
+ * @return The idle time in microseconds of the context clock
+ *
+ * @see libinput_seat_set_idle_handler
+ * @see libinput_set_clock
+ *
+ * @since 1.22
+ */
+uint64_t
+libinput_seat_get_idle_time(struct libinput_seat *seat);
+
+/**
+ * @ingroup seat
+ *
+ * Handler called when a seat becomes idle or active again, see
+ * libinput_seat_set_idle_handler().
+ *
+ * @param seat The seat
+ * @param idle Non-zero if the seat has been idle for the timeout, zero
+ * on the first input after the seat was reported idle
+ * @param user_data The user_data passed to
+ * libinput_seat_set_idle_handler()
+ *
+ * @since 1.22
+ */
+typedef void (*libinput_seat_idle_handler)(struct libinput_seat *seat,
+					   int idle,
+					   void *user_data);
+
+/**
+ * @ingroup seat
+ *
+ * Have the handler called from within libinput_dispatch() once there was
+ * no input on this seat for the given timeout, and again on the first
+ * input after that. A caller only interested in idleness thus does not
+ * need to retrieve the events of the seat. Setting a handler replaces
+ * the previous one, the timeout runs from the last input.
+ *
+ * @param seat A previously obtained seat
+ * @param timeout The idle timeout in microseconds
+ * @param handler The handler, or NULL to remove the handler
+ * @param user_data Caller-specific data passed to the handler
+ *
+ * @see libinput_seat_get_idle_time
+ *
+ * @since 1.22
+ */
+void
+libinput_seat_set_idle_handler(struct libinput_seat *seat,
+			       uint64_t timeout,
+			       libinput_seat_idle_handler handler,
+			       void *user_data);
+
 /**
  * @defgroup device Initialization and manipulation of input devices
  */
@@ -4043,6 +4534,194 @@ libinput_device_get_user_data(struct libinput_device *device);
 struct libinput *
 libinput_device_get_context(struct libinput_device *device);
 
+/**
+ * @ingroup device
+ *
+ * Handler for raw relative motion, see
+ * libinput_device_set_raw_motion_handler().
+ *
+ * @param device The device the motion originates from
+ * @param time The kernel timestamp of the motion in microseconds
+ * @param dx The unaccelerated motion on the x axis
+ * @param dy The unaccelerated motion on the y axis
+ * @param user_data The user_data passed to
+ * libinput_device_set_raw_motion_handler()
+ *
+ * @since 1.22
+ */
+typedef void (*libinput_raw_motion_handler)(struct libinput_device *device,
+					    uint64_t time,
+					    double dx,
+					    double dy,
+					    void *user_data);
+
+/**
+ * @ingroup device
+ *
+ * Switch the device into raw motion mode, intended for clients such as
+ * games that want relative motion exactly as reported by the device.
+ *
+ * In raw mode, every relative motion record read from the device is
+ * passed to the handler from within libinput_dispatch() as soon as it is
+ * read. No event is allocated or queued, no acceleration, rotation or
+ * other configuration is applied and motion is not coalesced, so a single
+ * device report may result in one call per axis. The timestamp is the
+ * kernel timestamp of the record. Button, scroll and other events of the
+ * device are still delivered as regular events through
+ * libinput_get_event().
+ *
+ * Switching modes does not lose motion: motion accumulated for a pending
+ * @ref LIBINPUT_EVENT_POINTER_MOTION is queued before raw mode takes
+ * effect. Passing a NULL handler switches the device back to regular
+ * motion events, starting with the next record read.
+ *
+ * @param device A previously obtained device
+ * @param handler The raw motion handler, or NULL to leave raw mode
+ * @param user_data Caller-specific data passed to the handler
+ * @return 0 on success or -EINVAL if the device does not have the @ref
+ * LIBINPUT_DEVICE_CAP_POINTER capability
+ *
+ * @since 1.22
+ */
+int
+libinput_device_set_raw_motion_handler(struct libinput_device *device,
+				       libinput_raw_motion_handler handler,
+				       void *user_data);
+
+/**
+ * @ingroup device
+ *
+ * Limit the rate of events a device can generate, to keep a faulty or
+ * malicious device from flooding the context. The limit is a token
+ * bucket refilled at the given rate, holding at most burst tokens; every
+ * event takes one token.
+ *
+ * While the device is over budget, pointer motion is not posted but
+ * accumulated, and posted as a single event once a token is available.
+ * Key, button and scroll events are always posted but counted as over
+ * budget. Exceeding the limit is logged, at most once every few seconds.
+ * See libinput_device_get_stats() for the counters.
+ *
+ * @param device A previously obtained device
+ * @param rate The number of events per second, or 0 to remove the limit
+ * @param burst The number of events allowed in a burst, must be greater
+ * than 0 unless rate is 0
+ * @return 0 on success or -EINVAL if burst is 0 with a non-zero rate
+ *
+ * @since 1.22
+ */
+int
+libinput_device_set_rate_limit(struct libinput_device *device,
+			       unsigned int rate,
+			       unsigned int burst);
+
+/**
+ * @ingroup device
+ *
+ * Accelerate the scroll wheel of a device. Clicks arriving faster than a
+ * threshold rate scroll further the faster the wheel turns, so a flick
+ * covers long documents. While the wheel turns that fast, clicks are
+ * merged into one @ref LIBINPUT_EVENT_POINTER_SCROLL_WHEEL event about
+ * every 16ms. Both libinput_event_pointer_get_scroll_value() and
+ * libinput_event_pointer_get_scroll_value_v120() of such an event are
+ * accelerated by the same factor, so the v120 value exceeds 120 times the
+ * number of clicks merged.
+ *
+ * Wheel acceleration is disabled by default. Clicks held back when
+ * the setting changes are posted first.
+ *
+ * @param device A previously obtained device
+ * @param enable Non-zero to enable wheel acceleration, zero to disable it
+ * @return 0 on success or -EINVAL if the device does not have the @ref
+ * LIBINPUT_DEVICE_CAP_POINTER capability
+ *
+ * @since 1.22
+ */
+int
+libinput_device_set_wheel_acceleration(struct libinput_device *device,
+				       int enable);
+
+/**
+ * @ingroup device
+ *
+ * Suspend the internal keyboard and touchpad of the seat while the lid
+ * switch of this device is on, i.e. the lid is closed. They are closed and
+ * out of the event loop, so they cause no wakeups, and reopened when the
+ * lid opens, when this is disabled, or when the switch device is removed.
+ * Internal devices are those of the pckbc(4) device group.
+ *
+ * This is disabled by default. The @ref LIBINPUT_EVENT_SWITCH_TOGGLE
+ * events are posted either way.
+ *
+ * @param device A previously obtained device
+ * @param enable Non-zero to suspend the internal devices with the lid,
+ * zero to never do so
+ * @return 0 on success or -EINVAL if the device has no @ref
+ * LIBINPUT_SWITCH_LID
+ *
+ * @since 1.22
+ */
+int
+libinput_device_set_lid_suspend(struct libinput_device *device, int enable);
+
+/**
+ * @ingroup device
+ * @struct libinput_device_stats
+ *
+ * Counters of a device since it was added, see libinput_device_get_stats().
+ * Fields are only ever appended to this struct.
+ *
+ * @since 1.22
+ */
+struct libinput_device_stats {
+	/** The number of bytes filled in by libinput_device_get_stats() */
+	uint32_t size;
+	/** Records read from the kernel */
+	uint64_t records;
+	/** Events posted for this device */
+	uint64_t events;
+	/** Motion frames merged into a later one by the rate limit */
+	uint64_t merged;
+	/** Key, button and scroll events posted over the rate limit */
+	uint64_t over_budget;
+	/** Suspected kernel event queue overflows */
+	uint64_t overflows;
+	/**
+	 * Sum of the time in microseconds between the kernel timestamp of
+	 * each record and the moment it was read
+	 */
+	uint64_t read_latency_total;
+	/** The longest such time in microseconds */
+	uint64_t read_latency_max;
+	/**
+	 * Touches never posted or cancelled because they were under the pen
+	 * of a tablet in the same device group
+	 */
+	uint64_t suppressed_touches;
+};
+
+/**
+ * @ingroup device
+ *
+ * Copy the counters of the device into a caller-provided struct. The size
+ * argument is the size of the caller's struct, i.e. sizeof(*stats);
+ * libinput fills in at most that many bytes.
+ *
+ * @param device A previously obtained device
+ * @param stats The struct to fill in
+ * @param size The size of the struct in bytes
+ * @return The number of bytes filled in, or -EINVAL if size is too small
+ * to hold the size field
+ *
+ * @see libinput_device_set_rate_limit
+ *
+ * @since 1.22
+ */
+int
+libinput_device_get_stats(struct libinput_device *device,
+			  struct libinput_device_stats *stats,
+			  size_t size);
+
 /**
  * @ingroup device
  *
@@ -4098,8 +4777,10 @@ libinput_device_get_context(struct libinput_device *device);
  * libinput_device_group_unref() to continue using the handle outside of the
  * immediate scope.
  *
- * Device groups are assigned based on the <b>LIBINPUT_DEVICE_GROUP</b> udev
- * property, see the libinput documentation for more details.
+ * Device groups are assigned when a device is opened. The evdev nodes of
+ * one piece of hardware share its bus, vendor and product ids and its
+ * physical path. The internal keyboard and the PS/2 mouse or touchpad of
+ * a laptop share a group. Any other device is in a group of its own.
  *
  * @return The device group this device belongs to
  */
@@ -4549,6 +5230,61 @@ libinput_device_group_get_user_data(struct libinput_device_group *group);
  *    - libinput_device_config_send_events_set_mode()
  */
 
+/**
+ * @ingroup config
+ *
+ * Begin a configuration transaction on the device. Until
+ * libinput_device_config_commit(), the setters of the acceleration
+ * speed and profile, the rotation angle, the scroll method, the send
+ * events mode and the absolute to relative conversion only validate and
+ * stage their value, returning @ref LIBINPUT_CONFIG_STATUS_SUCCESS for a
+ * valid one. The matching getters return the staged value, events keep
+ * being processed with the current settings.
+ *
+ * Other settings take effect immediately, as outside a transaction.
+ *
+ * @param device A previously obtained device
+ * @return 0 on success or -EBUSY if a transaction is already open on the
+ * device
+ *
+ * @see libinput_device_config_commit
+ * @see libinput_device_config_abort
+ *
+ * @since 1.22
+ */
+int
+libinput_device_config_begin(struct libinput_device *device);
+
+/**
+ * @ingroup config
+ *
+ * Apply all settings staged since libinput_device_config_begin() and
+ * close the transaction. Derived state such as the acceleration table is
+ * computed once for all of them. Every event posted afterwards uses
+ * the new settings, and no event ever uses only part of them.
+ *
+ * @param device A previously obtained device
+ * @return 0 on success or -EINVAL if no transaction is open on the device
+ *
+ * @since 1.22
+ */
+int
+libinput_device_config_commit(struct libinput_device *device);
+
+/**
+ * @ingroup config
+ *
+ * Discard all settings staged since libinput_device_config_begin() and
+ * close the transaction. Calling this function without an open
+ * transaction has no effect.
+ *
+ * @param device A previously obtained device
+ *
+ * @since 1.22
+ */
+void
+libinput_device_config_abort(struct libinput_device *device);
+
 /**
  * @ingroup config
  *
@@ -5054,6 +5790,12 @@ enum libinput_config_send_events_mode {
 	 * If an external pointer device is plugged in, do not send events
 	 * from this device. This option may be available on built-in
 	 * touchpads.
+	 *
+	 * On wscons this is only offered for touchpads added with
+	 * libinput_path_add_device(), and only mice added that way count as
+	 * external. The seat assigned with libinput_udev_assign_seat() only
+	 * has the /dev/wsmouse mux, which combines the touchpad with every
+	 * other mouse.
 	 */
 	LIBINPUT_CONFIG_SEND_EVENTS_DISABLED_ON_EXTERNAL_MOUSE = (1 << 1),
 };
@@ -6153,6 +6895,113 @@ libinput_device_config_dwtp_get_enabled(struct libinput_device *device);
 enum libinput_config_dwtp_state
 libinput_device_config_dwtp_get_default_enabled(struct libinput_device *device);
 
+/**
+ * @ingroup config
+ *
+ * @since 1.22
+ */
+enum libinput_config_abs_to_rel_state {
+	LIBINPUT_CONFIG_ABS_TO_REL_DISABLED,
+	LIBINPUT_CONFIG_ABS_TO_REL_ENABLED,
+};
+
+/**
+ * @ingroup config
+ *
+ * Check if this device can convert absolute positions into relative
+ * motion. This is intended for devices that only report absolute
+ * positions, e.g. the tablet emulated by most virtual machines, used by
+ * clients that need relative motion. It is only available on devices
+ * reporting an absolute axis range.
+ *
+ * A position far from the previous one, e.g. where the pointer re-enters
+ * the window of a virtual machine, is taken as a new reference and moves
+ * nothing.
+ *
+ * @param device The device to configure
+ * @return Non-zero if the conversion is available, zero otherwise.
+ *
+ * @see libinput_device_config_abs_to_rel_set_enabled
+ * @see libinput_device_config_abs_to_rel_get_enabled
+ * @see libinput_device_config_abs_to_rel_get_default_enabled
+ *
+ * @since 1.22
+ */
+int
+libinput_device_config_abs_to_rel_is_available(struct libinput_device *device);
+
+/**
+ * @ingroup config
+ *
+ * Enable or disable the conversion of absolute positions into relative
+ * motion. When enabled, the difference between consecutive absolute
+ * positions is sent as @ref LIBINPUT_EVENT_POINTER_MOTION, subject to the
+ * same configuration as motion of a relative device.
+ *
+ * Positions are scaled with the resolution of the device if it has one,
+ * otherwise a sweep across the full range of an axis translates into
+ * roughly the motion of a mouse moved across a screen. A jump across more
+ * than half the range of an axis is taken as the position wrapping around
+ * at the edge and converted into the short motion across the edge. After
+ * enabling and after the device lost track of the position, the first
+ * position only serves as the new reference and produces no motion.
+ *
+ * @param device The device to configure
+ * @param state @ref LIBINPUT_CONFIG_ABS_TO_REL_ENABLED to enable the
+ * conversion, @ref LIBINPUT_CONFIG_ABS_TO_REL_DISABLED to disable it
+ *
+ * @return A config status code. Disabling the conversion on a device that
+ * does not support it always succeeds.
+ *
+ * @see libinput_device_config_abs_to_rel_is_available
+ * @see libinput_device_config_abs_to_rel_get_enabled
+ * @see libinput_device_config_abs_to_rel_get_default_enabled
+ *
+ * @since 1.22
+ */
+enum libinput_config_status
+libinput_device_config_abs_to_rel_set_enabled(struct libinput_device *device,
+	enum libinput_config_abs_to_rel_state state);
+
+/**
+ * @ingroup config
+ *
+ * Check if the conversion of absolute positions into relative motion is
+ * enabled on this device. If the device does not support the conversion,
+ * this function returns @ref LIBINPUT_CONFIG_ABS_TO_REL_DISABLED.
+ *
+ * @param device The device to configure
+ * @return @ref LIBINPUT_CONFIG_ABS_TO_REL_DISABLED if disabled, @ref
+ * LIBINPUT_CONFIG_ABS_TO_REL_ENABLED if enabled.
+ *
+ * @see libinput_device_config_abs_to_rel_is_available
+ * @see libinput_device_config_abs_to_rel_set_enabled
+ * @see libinput_device_config_abs_to_rel_get_default_enabled
+ *
+ * @since 1.22
+ */
+enum libinput_config_abs_to_rel_state
+libinput_device_config_abs_to_rel_get_enabled(struct libinput_device *device);
+
+/**
+ * @ingroup config
+ *
+ * Check if the conversion of absolute positions into relative motion is
+ * enabled on this device by default. The conversion is always disabled by
+ * default.
+ *
+ * @param device The device to configure
+ * @return @ref LIBINPUT_CONFIG_ABS_TO_REL_DISABLED
+ *
+ * @see libinput_device_config_abs_to_rel_is_available
+ * @see libinput_device_config_abs_to_rel_set_enabled
+ * @see libinput_device_config_abs_to_rel_get_enabled
+ *
+ * @since 1.22
+ */
+enum libinput_config_abs_to_rel_state
+libinput_device_config_abs_to_rel_get_default_enabled(struct libinput_device *device);
+
 /**
  * @ingroup config
  *
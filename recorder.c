@@ -0,0 +1,301 @@
+/*
+ * Copyright © 2026 libinput contributors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+/*
+ * Flight recorder. Every device keeps the last records read from it in a
+ * fixed-size ring, appended to with one memcpy per read (two when the
+ * batch wraps around the end of the ring).
+ *
+ * The dump is a compressed form of the records, all integers are
+ * LEB128 varints, signed ones zigzag-encoded first:
+ *
+ *	"LIFR" <version = 1>
+ *	per device:
+ *	    <name length> <name> <record count>
+ *	    per record: <type> <signed value> <signed time delta, usec>
+ *
+ * The time delta of the first record of a device is relative to 0, that
+ * of the following ones relative to the previous record.
+ */
+
+#include <errno.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <dev/wscons/wsconsio.h>
+
+#include "libinput.h"
+#include "libinput-util.h"
+#include "libinput-private.h"
+
+#define FLIGHT_RECORDER_MAGIC	"LIFR"
+#define FLIGHT_RECORDER_VERSION	1
+
+struct flight_recorder {
+	struct wscons_event *records;
+	unsigned int size;
+	uint64_t head;		/* total number of records ever appended */
+};
+
+struct flight_writer {
+	int fd;
+	size_t len;
+	uint8_t buf[4096];
+};
+
+struct flight_recorder *
+flight_recorder_create(unsigned int size)
+{
+	struct flight_recorder *recorder;
+
+	recorder = zalloc(sizeof(*recorder));
+	if (recorder == NULL)
+		return NULL;
+
+	recorder->records = calloc(size, sizeof(*recorder->records));
+	if (recorder->records == NULL) {
+		free(recorder);
+		return NULL;
+	}
+	recorder->size = size;
+
+	return recorder;
+}
+
+void
+flight_recorder_destroy(struct flight_recorder *recorder)
+{
+	if (recorder == NULL)
+		return;
+
+	free(recorder->records);
+	free(recorder);
+}
+
+void
+flight_recorder_append(struct flight_recorder *recorder,
+		       const struct wscons_event *records,
+		       unsigned int count)
+{
+	unsigned int start, n;
+
+	/* Only the tail of an oversized batch survives anyway */
+	if (count > recorder->size) {
+		records += count - recorder->size;
+		recorder->head += count - recorder->size;
+		count = recorder->size;
+	}
+
+	start = recorder->head % recorder->size;
+	n = min(count, recorder->size - start);
+
+	memcpy(&recorder->records[start], records, n * sizeof(*records));
+	if (n < count)
+		memcpy(recorder->records, records + n,
+		       (count - n) * sizeof(*records));
+
+	recorder->head += count;
+}
+
+static int
+flight_writer_flush(struct flight_writer *w)
+{
+	size_t off = 0;
+	ssize_t rc;
+
+	while (off < w->len) {
+		rc = write(w->fd, w->buf + off, w->len - off);
+		if (rc == -1) {
+			if (errno == EINTR)
+				continue;
+			return -errno;
+		}
+		off += rc;
+	}
+	w->len = 0;
+
+	return 0;
+}
+
+static int
+flight_writer_put(struct flight_writer *w, const void *data, size_t len)
+{
+	const uint8_t *p = data;
+	size_t n;
+	int rc;
+
+	while (len > 0) {
+		if (w->len == sizeof(w->buf) &&
+		    (rc = flight_writer_flush(w)) != 0)
+			return rc;
+
+		n = min(len, sizeof(w->buf) - w->len);
+		memcpy(w->buf + w->len, p, n);
+		w->len += n;
+		p += n;
+		len -= n;
+	}
+
+	return 0;
+}
+
+static int
+flight_writer_varint(struct flight_writer *w, uint64_t value)
+{
+	uint8_t bytes[10];
+	size_t n = 0;
+
+	do {
+		bytes[n] = value & 0x7f;
+		value >>= 7;
+		if (value)
+			bytes[n] |= 0x80;
+		n++;
+	} while (value);
+
+	return flight_writer_put(w, bytes, n);
+}
+
+static int
+flight_writer_svarint(struct flight_writer *w, int64_t value)
+{
+	return flight_writer_varint(w,
+		((uint64_t)value << 1) ^ (uint64_t)(value >> 63));
+}
+
+static int
+flight_recorder_write(struct flight_recorder *recorder,
+		      const char *name,
+		      struct flight_writer *w)
+{
+	const struct wscons_event *record;
+	uint64_t i, first, time, prev = 0;
+	size_t len = strlen(name);
+	int rc;
+
+	first = recorder->head > recorder->size ?
+		recorder->head - recorder->size : 0;
+
+	if ((rc = flight_writer_varint(w, len)) != 0 ||
+	    (rc = flight_writer_put(w, name, len)) != 0 ||
+	    (rc = flight_writer_varint(w, recorder->head - first)) != 0)
+		return rc;
+
+	for (i = first; i < recorder->head; i++) {
+		record = &recorder->records[i % recorder->size];
+		time = s2us(record->time.tv_sec) + ns2us(record->time.tv_nsec);
+
+		if ((rc = flight_writer_varint(w, record->type)) != 0 ||
+		    (rc = flight_writer_svarint(w, record->value)) != 0 ||
+		    (rc = flight_writer_svarint(w, (int64_t)(time - prev))) != 0)
+			return rc;
+		prev = time;
+	}
+
+	return 0;
+}
+
+LIBINPUT_EXPORT int
+libinput_flight_recorder_enable(struct libinput *libinput,
+				unsigned int num_records)
+{
+	struct libinput_seat *seat;
+	struct libinput_device *device;
+	struct flight_recorder *recorder;
+
+	if (num_records == 0)
+		return -EINVAL;
+
+	libinput_flight_recorder_disable(libinput);
+	libinput->recorder_size = num_records;
+
+	list_for_each(seat, &libinput->seat_list, link) {
+		list_for_each(device, &seat->devices_list, link) {
+			recorder = flight_recorder_create(num_records);
+			if (recorder == NULL) {
+				libinput_flight_recorder_disable(libinput);
+				return -ENOMEM;
+			}
+			device->recorder = recorder;
+		}
+	}
+
+	return 0;
+}
+
+LIBINPUT_EXPORT void
+libinput_flight_recorder_disable(struct libinput *libinput)
+{
+	struct libinput_seat *seat;
+	struct libinput_device *device;
+
+	libinput->recorder_size = 0;
+
+	list_for_each(seat, &libinput->seat_list, link) {
+		list_for_each(device, &seat->devices_list, link) {
+			flight_recorder_destroy(device->recorder);
+			device->recorder = NULL;
+		}
+	}
+}
+
+LIBINPUT_EXPORT int
+libinput_flight_recorder_dump(struct libinput *libinput, int fd)
+{
+	struct libinput_seat *seat;
+	struct libinput_device *device;
+	struct flight_writer *w;
+	uint8_t version = FLIGHT_RECORDER_VERSION;
+	int rc;
+
+	if (libinput->recorder_size == 0)
+		return -EINVAL;
+
+	w = zalloc(sizeof(*w));
+	if (w == NULL)
+		return -ENOMEM;
+	w->fd = fd;
+
+	rc = flight_writer_put(w, FLIGHT_RECORDER_MAGIC,
+			       strlen(FLIGHT_RECORDER_MAGIC));
+	if (rc == 0)
+		rc = flight_writer_put(w, &version, sizeof(version));
+
+	list_for_each(seat, &libinput->seat_list, link) {
+		list_for_each(device, &seat->devices_list, link) {
+			if (rc != 0)
+				break;
+			if (device->recorder != NULL)
+				rc = flight_recorder_write(device->recorder,
+							   device->devname, w);
+		}
+	}
+
+	if (rc == 0)
+		rc = flight_writer_flush(w);
+	free(w);
+
+	return rc;
+}
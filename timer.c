@@ -0,0 +1,185 @@
+/*
+ * Copyright © 2014-2015 Red Hat, Inc.
+ * Copyright © 2026 libinput contributors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+/*
+ * All timers of a context share a single one-shot EVFILT_TIMER on the
+ * context's kqueue, armed for the earliest expiry. Expired timers are run
+ * from libinput_dispatch(). With a caller-provided clock the kqueue timer
+ * is never armed, the caller drives time by calling libinput_dispatch().
+ */
+
+#include <sys/types.h>
+#include <sys/event.h>
+
+#include <assert.h>
+#include <errno.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+
+#include "libinput.h"
+#include "libinput-util.h"
+#include "libinput-private.h"
+
+/* EVFILT_TIMER idents live in their own namespace, apart from fds */
+#define LIBINPUT_TIMER_IDENT 1
+
+uint64_t
+libinput_now(struct libinput *libinput)
+{
+	struct timespec ts;
+
+	if (libinput->clock != NULL)
+		return libinput->clock->now(libinput->clock_data);
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return s2us(ts.tv_sec) + ns2us(ts.tv_nsec);
+}
+
+static void
+libinput_timer_arm_timer(struct libinput *libinput)
+{
+	struct libinput_timer *timer;
+	struct kevent kev;
+	uint64_t earliest = UINT64_MAX;
+	uint64_t now;
+	int64_t ms;
+
+	if (libinput->clock == NULL) {
+		list_for_each(timer, &libinput->timer.list, link) {
+			if (timer->expire < earliest)
+				earliest = timer->expire;
+		}
+	}
+
+	if (earliest == UINT64_MAX) {
+		if (libinput->timer.next_expiry == 0)
+			return;
+
+		EV_SET(&kev, LIBINPUT_TIMER_IDENT, EVFILT_TIMER, EV_DELETE,
+		       0, 0, NULL);
+		kevent(libinput->kq, &kev, 1, NULL, 0, NULL);
+		libinput->timer.next_expiry = 0;
+		return;
+	}
+
+	if (earliest == libinput->timer.next_expiry)
+		return;
+
+	/* EVFILT_TIMER has millisecond granularity, round up */
+	now = libinput_now(libinput);
+	ms = earliest > now ? (earliest - now + 999) / 1000 : 1;
+
+	EV_SET(&kev, LIBINPUT_TIMER_IDENT, EVFILT_TIMER, EV_ADD | EV_ONESHOT,
+	       0, ms, NULL);
+	if (kevent(libinput->kq, &kev, 1, NULL, 0, NULL) == -1) {
+		log_error(libinput, "timer: failed to arm kqueue timer: %s\n",
+			  strerror(errno));
+		return;
+	}
+
+	libinput->timer.next_expiry = earliest;
+}
+
+void
+libinput_timer_init(struct libinput_timer *timer,
+		    struct libinput *libinput,
+		    void (*timer_func)(uint64_t now, void *timer_func_data),
+		    void *timer_func_data)
+{
+	timer->libinput = libinput;
+	timer->expire = 0;
+	timer->timer_func = timer_func;
+	timer->timer_func_data = timer_func_data;
+}
+
+void
+libinput_timer_set(struct libinput_timer *timer, uint64_t expire)
+{
+	assert(expire != 0);
+
+	if (timer->expire == 0)
+		list_insert(&timer->libinput->timer.list, &timer->link);
+
+	timer->expire = expire;
+	libinput_timer_arm_timer(timer->libinput);
+}
+
+void
+libinput_timer_cancel(struct libinput_timer *timer)
+{
+	if (timer->expire == 0)
+		return;
+
+	timer->expire = 0;
+	list_remove(&timer->link);
+	libinput_timer_arm_timer(timer->libinput);
+}
+
+void
+libinput_timer_handler(struct libinput *libinput)
+{
+	struct libinput_timer *timer;
+	uint64_t now;
+	bool fired;
+
+	if (list_empty(&libinput->timer.list))
+		return;
+
+	now = libinput_now(libinput);
+
+	/*
+	 * A timer function may set or cancel any timer, restart the scan
+	 * after each one rather than trust the iterator.
+	 */
+	do {
+		fired = false;
+		list_for_each(timer, &libinput->timer.list, link) {
+			if (timer->expire > now)
+				continue;
+
+			timer->expire = 0;
+			list_remove(&timer->link);
+			timer->timer_func(now, timer->timer_func_data);
+			fired = true;
+			break;
+		}
+	} while (fired);
+
+	libinput_timer_arm_timer(libinput);
+}
+
+LIBINPUT_EXPORT void
+libinput_set_clock(struct libinput *libinput,
+		   const struct libinput_clock_interface *clock,
+		   void *user_data)
+{
+	libinput->clock = clock;
+	libinput->clock_data = user_data;
+
+	/* Force re-arming against the new clock */
+	if (libinput->timer.next_expiry != 0)
+		libinput->timer.next_expiry = UINT64_MAX;
+	libinput_timer_arm_timer(libinput);
+}
@@ -0,0 +1,528 @@
+/*
+ * Copyright © 2026 libinput contributors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+/*
+ * libinput-measure: report rate, inter-report jitter and kernel-to-dequeue
+ * latency of input devices.
+ *
+ * A report is a group of events sharing one kernel timestamp, e.g. the
+ * x and y motion of a single mouse report. Latency compares the kernel
+ * timestamp against CLOCK_REALTIME at the time the event is taken off the
+ * libinput queue; wscons(4) timestamps events with the real-time clock.
+ *
+ * Replay files are line based:
+ *
+ *	# comment
+ *	D: <device name>
+ *	E: <time in microseconds> <code>
+ *
+ * Every E: line belongs to the last D: line. A D: line naming a device
+ * seen before switches back to it, so the events of several devices may
+ * interleave. The code is informational only. Replays carry no dequeue
+ * times, so no latency is reported for them. The -o option writes the
+ * events of a live session in this format.
+ *
+ * -r also reads flight recorder dumps, see recorder.c for their format.
+ * With -d, a live session keeps a flight recorder running and dumps it
+ * to the given file on SIGUSR1.
+ */
+
+#include <sys/types.h>
+
+#include <err.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <math.h>
+#include <poll.h>
+#include <signal.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "libinput.h"
+
+#define MAX_DEVICES	16
+#define FLIGHT_RECORDS	4096	/* records kept per device with -d */
+#define NBUCKETS	24	/* log2 microsecond buckets, up to ~8s */
+#define BAR_WIDTH	50
+
+struct histogram {
+	uint64_t bucket[NBUCKETS];
+	uint64_t count;
+	uint64_t max;
+	double sum;
+	double sum2;
+};
+
+struct measure {
+	char *name;
+	uint64_t first;
+	uint64_t last;
+	uint64_t nreports;
+	struct histogram interval;
+	struct histogram latency;
+};
+
+static struct measure measures[MAX_DEVICES];
+static int nmeasures;
+static volatile sig_atomic_t stop;
+static volatile sig_atomic_t dump;
+static FILE *record;
+static const char *dump_path;
+
+static void
+usage(void)
+{
+	fprintf(stderr,
+		"usage: libinput-measure [-d file] [-o file] [-t seconds] "
+		"device ...\n"
+		"       libinput-measure -r file\n");
+	exit(1);
+}
+
+static void
+sighandler(int sig)
+{
+	if (sig == SIGUSR1)
+		dump = 1;
+	else
+		stop = 1;
+}
+
+static uint64_t
+now_usec(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_REALTIME, &ts);
+	return (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+static struct measure *
+measure_new(const char *name)
+{
+	struct measure *m;
+
+	if (nmeasures == MAX_DEVICES)
+		errx(1, "too many devices (max %d)", MAX_DEVICES);
+
+	m = &measures[nmeasures++];
+	m->name = strdup(name);
+	if (m->name == NULL)
+		err(1, NULL);
+
+	return m;
+}
+
+/* The measure of a device named before, or a new one */
+static struct measure *
+measure_get(const char *name)
+{
+	int i;
+
+	for (i = 0; i < nmeasures; i++) {
+		if (strcmp(measures[i].name, name) == 0)
+			return &measures[i];
+	}
+
+	return measure_new(name);
+}
+
+static void
+histogram_add(struct histogram *h, uint64_t value)
+{
+	int b = 0;
+
+	while (b < NBUCKETS - 1 && value >= (2ULL << b))
+		b++;
+
+	h->bucket[b]++;
+	h->count++;
+	h->sum += value;
+	h->sum2 += (double)value * value;
+	if (value > h->max)
+		h->max = value;
+}
+
+static double
+histogram_mean(const struct histogram *h)
+{
+	return h->count ? h->sum / h->count : 0;
+}
+
+static double
+histogram_stddev(const struct histogram *h)
+{
+	double mean = histogram_mean(h);
+
+	if (h->count < 2)
+		return 0;
+
+	return sqrt(fmax(h->sum2 / h->count - mean * mean, 0));
+}
+
+static void
+histogram_print(const char *title, const struct histogram *h)
+{
+	uint64_t peak = 0;
+	int b, lo, hi, width;
+
+	printf("  %s: mean %.1fus, stddev %.1fus, max %lluus\n",
+	       title, histogram_mean(h), histogram_stddev(h),
+	       (unsigned long long)h->max);
+
+	for (b = 0; b < NBUCKETS; b++)
+		if (h->bucket[b] > peak)
+			peak = h->bucket[b];
+
+	for (lo = 0; lo < NBUCKETS && h->bucket[lo] == 0; lo++)
+		;
+	for (hi = NBUCKETS - 1; hi > lo && h->bucket[hi] == 0; hi--)
+		;
+
+	for (b = lo; b <= hi; b++) {
+		width = peak ? (int)(h->bucket[b] * BAR_WIDTH / peak) : 0;
+		printf("    %8lluus %8llu |",
+		       b == 0 ? 0ULL : 1ULL << b,
+		       (unsigned long long)h->bucket[b]);
+		while (width-- > 0)
+			putchar('#');
+		putchar('\n');
+	}
+}
+
+/* Account one event with the given kernel timestamp */
+static void
+measure_event(struct measure *m, uint64_t time, uint64_t dequeued)
+{
+	if (dequeued && dequeued >= time)
+		histogram_add(&m->latency, dequeued - time);
+
+	if (m->nreports > 0 && time == m->last)
+		return;
+
+	if (m->nreports == 0)
+		m->first = time;
+	else if (time > m->last)
+		histogram_add(&m->interval, time - m->last);
+
+	m->last = time;
+	m->nreports++;
+}
+
+static void
+measure_print(void)
+{
+	struct measure *m;
+	double duration;
+	int i;
+
+	for (i = 0; i < nmeasures; i++) {
+		m = &measures[i];
+		duration = (m->last - m->first) / 1e6;
+
+		printf("%s: %llu reports", m->name,
+		       (unsigned long long)m->nreports);
+		if (m->nreports > 1 && duration > 0)
+			printf(", %.1f Hz", (m->nreports - 1) / duration);
+		printf("\n");
+
+		if (m->interval.count)
+			histogram_print("interval", &m->interval);
+		if (m->latency.count)
+			histogram_print("latency", &m->latency);
+	}
+}
+
+static uint64_t
+read_varint(FILE *fp, const char *path)
+{
+	uint64_t value = 0;
+	int c, shift = 0;
+
+	do {
+		if ((c = getc(fp)) == EOF || shift > 63)
+			errx(1, "%s: truncated flight recorder dump", path);
+		value |= (uint64_t)(c & 0x7f) << shift;
+		shift += 7;
+	} while (c & 0x80);
+
+	return value;
+}
+
+static int64_t
+read_svarint(FILE *fp, const char *path)
+{
+	uint64_t value = read_varint(fp, path);
+
+	return (int64_t)(value >> 1) ^ -(int64_t)(value & 1);
+}
+
+static void
+replay_flight(FILE *fp, const char *path)
+{
+	struct measure *m;
+	uint64_t len, count, time;
+	char name[256];
+	int c;
+
+	if (getc(fp) != 1)
+		errx(1, "%s: unsupported flight recorder version", path);
+
+	while ((c = getc(fp)) != EOF) {
+		ungetc(c, fp);
+
+		len = read_varint(fp, path);
+		if (len >= sizeof(name) || fread(name, 1, len, fp) != len)
+			errx(1, "%s: invalid device name", path);
+		name[len] = '\0';
+		m = measure_new(name);
+
+		time = 0;
+		for (count = read_varint(fp, path); count > 0; count--) {
+			read_varint(fp, path);		/* type */
+			read_svarint(fp, path);		/* value */
+			time += read_svarint(fp, path);
+			measure_event(m, time, 0);
+		}
+	}
+}
+
+static int
+replay(const char *path)
+{
+	struct measure *m = NULL;
+	unsigned long long time;
+	char line[256], *p;
+	FILE *fp;
+	int lineno = 0;
+
+	if ((fp = fopen(path, "r")) == NULL)
+		err(1, "%s", path);
+
+	if (fread(line, 1, 4, fp) == 4 && memcmp(line, "LIFR", 4) == 0) {
+		replay_flight(fp, path);
+		fclose(fp);
+		measure_print();
+		return 0;
+	}
+	rewind(fp);
+
+	while (fgets(line, sizeof(line), fp) != NULL) {
+		lineno++;
+		line[strcspn(line, "\n")] = '\0';
+
+		if (line[0] == '#' || line[0] == '\0')
+			continue;
+
+		if (strncmp(line, "D: ", 3) == 0) {
+			m = measure_get(line + 3);
+		} else if (strncmp(line, "E: ", 3) == 0) {
+			errno = 0;
+			time = strtoull(line + 3, &p, 10);
+			if (errno != 0 || p == line + 3 || m == NULL)
+				errx(1, "%s:%d: invalid event", path, lineno);
+			measure_event(m, time, 0);
+		} else {
+			errx(1, "%s:%d: unknown line", path, lineno);
+		}
+	}
+
+	fclose(fp);
+	measure_print();
+
+	return 0;
+}
+
+static int
+open_restricted(const char *path, int flags, void *user_data)
+{
+	int fd = open(path, flags);
+
+	return fd < 0 ? -errno : fd;
+}
+
+static void
+close_restricted(int fd, void *user_data)
+{
+	close(fd);
+}
+
+static const struct libinput_interface interface = {
+	.open_restricted = open_restricted,
+	.close_restricted = close_restricted,
+};
+
+static void
+handle_events(struct libinput *li)
+{
+	static struct measure *recorded;	/* of the last D: line */
+	struct libinput_event_record rec;
+	struct libinput_event *event;
+	struct measure *m;
+	uint64_t dequeued;
+
+	while ((event = libinput_get_event(li)) != NULL) {
+		dequeued = now_usec();
+		libinput_event_get_record(event, &rec, sizeof(rec));
+		m = libinput_device_get_user_data(rec.device);
+
+		if (rec.time != 0 && m != NULL) {
+			measure_event(m, rec.time, dequeued);
+			if (record != NULL && m != recorded) {
+				fprintf(record, "D: %s\n", m->name);
+				recorded = m;
+			}
+			if (record != NULL)
+				fprintf(record, "E: %llu %d\n",
+					(unsigned long long)rec.time, rec.type);
+		}
+
+		libinput_event_destroy(event);
+	}
+}
+
+static void
+dump_flight(struct libinput *li)
+{
+	int fd, rc;
+
+	fd = open(dump_path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+	if (fd == -1) {
+		warn("%s", dump_path);
+		return;
+	}
+
+	rc = libinput_flight_recorder_dump(li, fd);
+	if (rc != 0)
+		warnx("%s: %s", dump_path, strerror(-rc));
+	close(fd);
+}
+
+static int
+measure_live(int argc, char **argv, int seconds)
+{
+	struct libinput *li;
+	struct libinput_device *device;
+	struct measure *m;
+	struct pollfd pfd;
+	uint64_t deadline = 0;
+	int i;
+
+	li = libinput_path_create_context(&interface, NULL);
+	if (li == NULL)
+		errx(1, "failed to create libinput context");
+
+	for (i = 0; i < argc; i++) {
+		device = libinput_path_add_device(li, argv[i]);
+		if (device == NULL)
+			errx(1, "%s: failed to add device", argv[i]);
+
+		m = measure_new(argv[i]);
+		libinput_device_set_user_data(device, m);
+	}
+
+	if (dump_path != NULL &&
+	    libinput_flight_recorder_enable(li, FLIGHT_RECORDS) != 0)
+		errx(1, "failed to enable the flight recorder");
+
+	signal(SIGINT, sighandler);
+	signal(SIGTERM, sighandler);
+	signal(SIGUSR1, sighandler);
+
+	if (seconds > 0)
+		deadline = now_usec() + (uint64_t)seconds * 1000000;
+
+	pfd.fd = libinput_get_fd(li);
+	pfd.events = POLLIN;
+
+	while (!stop && (deadline == 0 || now_usec() < deadline)) {
+		if (poll(&pfd, 1, 100) == -1) {
+			if (errno == EINTR)
+				continue;
+			err(1, "poll");
+		}
+
+		libinput_dispatch(li);
+		handle_events(li);
+
+		if (dump) {
+			dump = 0;
+			dump_flight(li);
+		}
+	}
+
+	libinput_unref(li);
+	if (record != NULL)
+		fclose(record);
+	measure_print();
+
+	return 0;
+}
+
+int
+main(int argc, char **argv)
+{
+	const char *replay_path = NULL;
+	const char *errstr;
+	int ch, seconds = 0;
+
+	while ((ch = getopt(argc, argv, "d:o:r:t:")) != -1) {
+		switch (ch) {
+		case 'd':
+			dump_path = optarg;
+			break;
+		case 'o':
+			if ((record = fopen(optarg, "w")) == NULL)
+				err(1, "%s", optarg);
+			fprintf(record, "# libinput-measure replay\n");
+			break;
+		case 'r':
+			replay_path = optarg;
+			break;
+		case 't':
+			seconds = strtonum(optarg, 1, 86400, &errstr);
+			if (errstr != NULL)
+				errx(1, "duration is %s: %s", errstr, optarg);
+			break;
+		default:
+			usage();
+		}
+	}
+	argc -= optind;
+	argv += optind;
+
+	if (replay_path != NULL) {
+		if (argc != 0 || record != NULL || dump_path != NULL)
+			usage();
+		return replay(replay_path);
+	}
+
+	if (argc == 0)
+		usage();
+
+	return measure_live(argc, argv, seconds);
+}
@@ -0,0 +1,346 @@
+/*
+ * Copyright © 2026 libinput contributors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+/*
+ * Touchpad scrolling. With a scroll method set, the touchpad is switched
+ * to the native mode of wsmouse(4) and reports the position of its
+ * primary contact and the number of contacts instead of the motion
+ * computed by the kernel. Each frame then either moves the pointer or
+ * scrolls, all state is kept in the device.
+ *
+ * Fingers resting on the touchpad without moving for a while begin a hold
+ * gesture. It ends when they lift, and is cancelled when they move or
+ * their number changes.
+ *
+ * Without a scroll method the touchpad stays in compat mode, where the
+ * kernel moves the pointer, taps and scrolls as configured with
+ * wsconsctl(8).
+ */
+
+#include <sys/ioctl.h>
+
+#include <errno.h>
+#include <math.h>
+#include <string.h>
+
+#include <dev/wscons/wsconsio.h>
+
+#include "libinput.h"
+#include "libinput-util.h"
+#include "libinput-private.h"
+
+/* Motion of a sweep across an axis of unknown resolution */
+#define TP_UNITS_SPAN		2000.0
+
+/* Width of the scroll edges */
+#define TP_EDGE_MM		7
+#define TP_EDGE_FRACTION	0.08
+
+/* Scrolling is held back until the fingers travelled this far */
+#define TP_SCROLL_LOCK_MM	1.5
+/* How much one axis has to dominate to scroll along it alone */
+#define TP_SCROLL_LOCK_RATIO	2.0
+
+/* Fingers resting this long begin a hold, unless they moved this far */
+#define TP_HOLD_TIMEOUT		ms2us(180)
+#define TP_HOLD_MOTION_MM	0.5
+
+static double
+tp_scale(struct libinput_device *device, int axis)
+{
+	int res, range;
+
+	if (!device->abs.valid)
+		return 1;
+
+	res = axis ? device->abs.res.y : device->abs.res.x;
+	range = axis ? device->abs.max.y - device->abs.min.y + 1 :
+		       device->abs.max.x - device->abs.min.x + 1;
+
+	return res > 0 ? MOTION_UNITS_PER_MM / res : TP_UNITS_SPAN / range;
+}
+
+static int
+tp_edge_width(struct libinput_device *device, int axis)
+{
+	int res, range;
+
+	res = axis ? device->abs.res.y : device->abs.res.x;
+	range = axis ? device->abs.max.y - device->abs.min.y + 1 :
+		       device->abs.max.x - device->abs.min.x + 1;
+
+	return res > 0 ? TP_EDGE_MM * res : range * TP_EDGE_FRACTION;
+}
+
+static enum tp_edge
+tp_touch_edge(struct libinput_device *device,
+	      const struct device_coords *point)
+{
+	if (!device->abs.valid)
+		return TP_EDGE_NONE;
+
+	if (point->x >= device->abs.max.x - tp_edge_width(device, 0))
+		return TP_EDGE_RIGHT;
+	if (point->y >= device->abs.max.y - tp_edge_width(device, 1))
+		return TP_EDGE_BOTTOM;
+
+	return TP_EDGE_NONE;
+}
+
+/*
+ * Scroll by the motion of this frame. The axes are locked once the
+ * fingers travelled far enough to tell the direction, what was held back
+ * until then is posted in one go.
+ */
+static void
+tp_scroll(struct libinput_device *device,
+	  uint64_t time,
+	  struct normalized_coords delta)
+{
+	struct normalized_coords *travel = &device->tp.scroll.travel;
+	uint32_t axes = device->tp.scroll.axes;
+	double ax, ay;
+
+	device->tp.scroll.active = true;
+
+	if (axes == 0) {
+		travel->x += delta.x;
+		travel->y += delta.y;
+		if (hypot(travel->x, travel->y) <
+		    TP_SCROLL_LOCK_MM * MOTION_UNITS_PER_MM)
+			return;
+
+		ax = fabs(travel->x);
+		ay = fabs(travel->y);
+		if (ay >= ax * TP_SCROLL_LOCK_RATIO)
+			axes = bit(LIBINPUT_POINTER_AXIS_SCROLL_VERTICAL);
+		else if (ax >= ay * TP_SCROLL_LOCK_RATIO)
+			axes = bit(LIBINPUT_POINTER_AXIS_SCROLL_HORIZONTAL);
+		else
+			axes = bit(LIBINPUT_POINTER_AXIS_SCROLL_VERTICAL) |
+			       bit(LIBINPUT_POINTER_AXIS_SCROLL_HORIZONTAL);
+
+		device->tp.scroll.axes = axes;
+		delta = *travel;
+	}
+
+	if (!(axes & bit(LIBINPUT_POINTER_AXIS_SCROLL_VERTICAL)))
+		delta.y = 0;
+	if (!(axes & bit(LIBINPUT_POINTER_AXIS_SCROLL_HORIZONTAL)))
+		delta.x = 0;
+	if (delta.x == 0 && delta.y == 0)
+		return;
+
+	pointer_notify_scroll_finger(device, time, axes, &delta);
+}
+
+/* A zero value on the scrolled axes tells the caller scrolling stopped */
+static void
+tp_scroll_stop(struct libinput_device *device, uint64_t time)
+{
+	struct normalized_coords zero = { 0, 0 };
+
+	if (!device->tp.scroll.active)
+		return;
+
+	if (device->tp.scroll.axes != 0)
+		pointer_notify_scroll_finger(device, time,
+					     device->tp.scroll.axes, &zero);
+
+	device->tp.scroll.active = false;
+	device->tp.scroll.axes = 0;
+	device->tp.scroll.travel = zero;
+}
+
+static void
+tp_hold_timeout(uint64_t now, void *data)
+{
+	struct libinput_device *device = data;
+
+	if (device->tp.hold.state != TP_HOLD_PENDING)
+		return;
+
+	device->tp.hold.state = TP_HOLD_ACTIVE;
+	gesture_notify_hold(device, device->tp.hold.start + TP_HOLD_TIMEOUT,
+			    device->tp.hold.fingers);
+}
+
+/* The timer runs on the context clock, the events on record time */
+static void
+tp_hold_start(struct libinput_device *device,
+	      uint64_t time,
+	      unsigned int fingers)
+{
+	struct libinput *libinput = device->seat->libinput;
+
+	device->tp.hold.state = TP_HOLD_PENDING;
+	device->tp.hold.fingers = fingers;
+	device->tp.hold.start = time;
+	device->tp.hold.travel = 0;
+	libinput_timer_set(&device->tp.hold.timer,
+			   libinput_now(libinput) + TP_HOLD_TIMEOUT);
+}
+
+static void
+tp_hold_end(struct libinput_device *device, uint64_t time, bool cancelled)
+{
+	libinput_timer_cancel(&device->tp.hold.timer);
+
+	if (device->tp.hold.state == TP_HOLD_ACTIVE)
+		gesture_notify_hold_end(device, time, device->tp.hold.fingers,
+					cancelled);
+	device->tp.hold.state = TP_HOLD_NONE;
+}
+
+static void
+tp_hold_motion(struct libinput_device *device,
+	       uint64_t time,
+	       const struct normalized_coords *delta)
+{
+	if (device->tp.hold.state == TP_HOLD_NONE)
+		return;
+
+	device->tp.hold.travel += hypot(delta->x, delta->y) /
+				  MOTION_UNITS_PER_MM;
+	if (device->tp.hold.travel > TP_HOLD_MOTION_MM)
+		tp_hold_end(device, time, true);
+}
+
+void
+tp_init(struct libinput_device *device)
+{
+	libinput_timer_init(&device->tp.hold.timer, device->seat->libinput,
+			    tp_hold_timeout, device);
+}
+
+void
+tp_process_frame(struct libinput_device *device, uint64_t time)
+{
+	struct tp_touch *t = &device->tp.touch;
+	enum libinput_config_scroll_method method = device->tp.method;
+	unsigned int fingers = device->tp.fingers;
+	struct normalized_coords delta;
+	bool changed;
+
+	changed = fingers != device->tp.last_fingers || device->tp.reset;
+	device->tp.last_fingers = fingers;
+	device->tp.reset = false;
+
+	if (fingers == 0) {
+		tp_hold_end(device, time, false);
+		tp_scroll_stop(device, time);
+		t->down = false;
+		return;
+	}
+
+	/* Other fingers, another hold */
+	if (!t->down || fingers != device->tp.hold.fingers) {
+		tp_hold_end(device, time, true);
+		tp_hold_start(device, time, fingers);
+	}
+
+	/* The reported contact may have changed, take a new reference */
+	if (!t->down || changed) {
+		if (!t->down)
+			t->edge = method == LIBINPUT_CONFIG_SCROLL_EDGE ?
+				  tp_touch_edge(device, &t->point) :
+				  TP_EDGE_NONE;
+		t->down = true;
+		t->last = t->point;
+		return;
+	}
+
+	delta.x = (t->point.x - t->last.x) * tp_scale(device, 0);
+	delta.y = (t->point.y - t->last.y) * tp_scale(device, 1);
+	t->last = t->point;
+
+	tp_hold_motion(device, time, &delta);
+
+	if (method == LIBINPUT_CONFIG_SCROLL_2FG && fingers >= 2) {
+		tp_scroll(device, time, delta);
+		return;
+	}
+
+	if (method == LIBINPUT_CONFIG_SCROLL_EDGE && fingers == 1 &&
+	    t->edge != TP_EDGE_NONE) {
+		if (t->edge == TP_EDGE_RIGHT)
+			delta.x = 0;
+		else
+			delta.y = 0;
+		tp_scroll(device, time, delta);
+		return;
+	}
+
+	tp_scroll_stop(device, time);
+	if (delta.x == 0 && delta.y == 0)
+		return;
+
+	device->motion.delta.x += delta.x;
+	device->motion.delta.y += delta.y;
+	device->motion.time = time;
+	device->motion.pending = true;
+}
+
+/* Forget the touch, ending a hold or a scroll in progress */
+void
+tp_release(struct libinput_device *device, uint64_t time)
+{
+	device->releasing = true;
+	tp_hold_end(device, time, true);
+	device->tp.hold.fingers = 0;
+	tp_scroll_stop(device, time);
+	device->tp.touch.down = false;
+	device->tp.fingers = 0;
+	device->tp.last_fingers = 0;
+	device->tp.reset = false;
+	device->releasing = false;
+}
+
+/* Switch an open touchpad to the mode its scroll method needs */
+void
+tp_update_mode(struct libinput_device *device)
+{
+	struct libinput *libinput = device->seat->libinput;
+	bool native = device->tp.method != LIBINPUT_CONFIG_SCROLL_NO_SCROLL;
+	int mode = native ? WSMOUSE_NATIVE : WSMOUSE_COMPAT;
+
+	tp_release(device, device->last_time);
+
+	if (device->fd == -1 || !wscons_device_is_touchpad(device)) {
+		device->tp.native = false;
+		return;
+	}
+
+	if (ioctl(device->fd, WSMOUSEIO_SETMODE, &mode) == -1) {
+		log_error(libinput, "%s: failed to set the touchpad mode: %s\n",
+			  device->devname, strerror(errno));
+		native = false;
+	}
+
+	/* Hold gestures are only detected in native mode */
+	device->tp.native = native;
+	if (native)
+		device->caps |= bit(LIBINPUT_DEVICE_CAP_GESTURE);
+	else
+		device->caps &= ~bit(LIBINPUT_DEVICE_CAP_GESTURE);
+}
@@ -0,0 +1,191 @@
+/*
+ * Copyright © 2026 libinput contributors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+/*
+ * Pipeline tracing. Spans are written into a ring allocated by
+ * libinput_trace_enable(); a writer claims its slot with a single atomic
+ * increment so recording never blocks or allocates. The dump is written
+ * in the Chrome trace event format, which Perfetto imports as-is.
+ */
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "libinput.h"
+#include "libinput-util.h"
+#include "libinput-private.h"
+
+struct trace_entry {
+	uint64_t begin;		/* ns, CLOCK_MONOTONIC */
+	uint64_t end;
+	uint32_t arg;
+	uint16_t span;
+};
+
+struct libinput_trace {
+	struct trace_entry *entries;
+	unsigned int size;
+	uint64_t head;		/* total number of spans ever recorded */
+};
+
+static const char *
+trace_span_name(enum trace_span span)
+{
+	switch (span) {
+	case TRACE_SPAN_DISPATCH: return "dispatch";
+	case TRACE_SPAN_READ: return "read";
+	case TRACE_SPAN_DECODE: return "decode";
+	case TRACE_SPAN_FRAME: return "frame";
+	case TRACE_SPAN_POST: return "post";
+	case TRACE_SPAN_DEQUEUE: return "dequeue";
+	}
+
+	return "unknown";
+}
+
+/* Name of the span argument, matching what the call sites pass in */
+static const char *
+trace_span_arg_name(enum trace_span span)
+{
+	switch (span) {
+	case TRACE_SPAN_READ: return "fd";
+	case TRACE_SPAN_DECODE: return "record";
+	case TRACE_SPAN_FRAME: return "records";
+	case TRACE_SPAN_POST:
+	case TRACE_SPAN_DEQUEUE: return "event";
+	case TRACE_SPAN_DISPATCH: return "sources";
+	}
+
+	return "arg";
+}
+
+uint64_t
+trace_now(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+void
+trace_record(struct libinput_trace *trace,
+	     enum trace_span span,
+	     uint64_t begin,
+	     uint64_t end,
+	     uint32_t arg)
+{
+	struct trace_entry *entry;
+	uint64_t slot;
+
+	slot = __atomic_fetch_add(&trace->head, 1, __ATOMIC_RELAXED);
+	entry = &trace->entries[slot % trace->size];
+	entry->begin = begin;
+	entry->end = end;
+	entry->arg = arg;
+	entry->span = span;
+}
+
+LIBINPUT_EXPORT int
+libinput_trace_enable(struct libinput *libinput, unsigned int num_spans)
+{
+	struct libinput_trace *trace;
+
+	if (num_spans == 0)
+		return -EINVAL;
+
+	trace = zalloc(sizeof(*trace));
+	if (trace == NULL)
+		return -ENOMEM;
+
+	trace->entries = calloc(num_spans, sizeof(*trace->entries));
+	if (trace->entries == NULL) {
+		free(trace);
+		return -ENOMEM;
+	}
+	trace->size = num_spans;
+
+	libinput_trace_disable(libinput);
+	libinput->trace = trace;
+
+	return 0;
+}
+
+LIBINPUT_EXPORT void
+libinput_trace_disable(struct libinput *libinput)
+{
+	struct libinput_trace *trace = libinput->trace;
+
+	if (trace == NULL)
+		return;
+
+	libinput->trace = NULL;
+	free(trace->entries);
+	free(trace);
+}
+
+LIBINPUT_EXPORT int
+libinput_trace_dump(struct libinput *libinput, int fd)
+{
+	struct libinput_trace *trace = libinput->trace;
+	struct trace_entry *entry;
+	uint64_t i, first, head;
+	pid_t pid = getpid();
+
+	if (trace == NULL)
+		return -EINVAL;
+
+	head = __atomic_load_n(&trace->head, __ATOMIC_ACQUIRE);
+	first = head > trace->size ? head - trace->size : 0;
+
+	if (dprintf(fd, "{\"traceEvents\":[") < 0)
+		return -errno;
+
+	for (i = first; i < head; i++) {
+		entry = &trace->entries[i % trace->size];
+		if (dprintf(fd,
+			    "%s\n{\"name\":\"%s\",\"cat\":\"libinput\","
+			    "\"ph\":\"X\",\"pid\":%d,\"tid\":%d,"
+			    "\"ts\":%llu.%03llu,\"dur\":%llu.%03llu,"
+			    "\"args\":{\"%s\":%u}}",
+			    i == first ? "" : ",",
+			    trace_span_name(entry->span),
+			    (int)pid, (int)pid,
+			    (unsigned long long)(entry->begin / 1000),
+			    (unsigned long long)(entry->begin % 1000),
+			    (unsigned long long)((entry->end - entry->begin) / 1000),
+			    (unsigned long long)((entry->end - entry->begin) % 1000),
+			    trace_span_arg_name(entry->span),
+			    entry->arg) < 0)
+			return -errno;
+	}
+
+	if (dprintf(fd, "\n],\"displayTimeUnit\":\"ns\"}\n") < 0)
+		return -errno;
+
+	return 0;
+}
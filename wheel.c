@@ -0,0 +1,190 @@
+/*
+ * Copyright © 2026 libinput contributors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+
+/*
+ * Wheel acceleration. Clicks arriving faster than WHEEL_ACCEL_THRESHOLD
+ * per second scroll further the faster they arrive, the rate is measured
+ * over the timestamps of the latest clicks. At that rate clicks are also
+ * merged: they are held back for up to WHEEL_MERGE_INTERVAL and posted as
+ * a single event, earlier if the direction changes or the device reports
+ * anything but motion.
+ *
+ * Slow clicks are posted as they arrive, unscaled, and so is every click
+ * unless acceleration was enabled for the device.
+ */
+
+#include <errno.h>
+#include <math.h>
+#include <string.h>
+
+#include "libinput.h"
+#include "libinput-util.h"
+#include "libinput-private.h"
+
+/* The scroll value of a single click */
+#define WHEEL_CLICK_UNITS	32
+
+/* Clicks older than this do not count towards the rate */
+#define WHEEL_RATE_WINDOW	ms2us(250)
+
+#define WHEEL_ACCEL_THRESHOLD	10.0	/* clicks/s */
+#define WHEEL_ACCEL_INCLINE	0.15	/* per click/s */
+#define WHEEL_ACCEL_MAX		8.0
+
+/* About a frame at 60Hz, longer would be noticeable */
+#define WHEEL_MERGE_INTERVAL	ms2us(16)
+
+/* v120 is scaled like the value, a click is 120 unless accelerated */
+static void
+wheel_post(struct libinput_device *device, uint64_t time, double value)
+{
+	struct normalized_coords delta = { 0, value };
+	struct wheel_v120 v120 = { 0, round(value * 120 / WHEEL_CLICK_UNITS) };
+
+	pointer_notify_scroll_wheel(device, time, &delta, &v120);
+}
+
+/* Clicks per second over the window, not counting the newest one */
+static double
+wheel_rate(struct libinput_device *device, uint64_t time)
+{
+	const uint64_t *clicks = device->wheel.clicks;
+	unsigned int n = ARRAY_LENGTH(device->wheel.clicks);
+	unsigned int i, idx, count = 0;
+	uint64_t oldest = time;
+
+	for (i = 1; i < n; i++) {
+		idx = (device->wheel.cur + n - i) % n;
+		if (clicks[idx] == 0 || clicks[idx] > time ||
+		    time - clicks[idx] > WHEEL_RATE_WINDOW)
+			break;
+
+		oldest = clicks[idx];
+		count++;
+	}
+
+	if (count == 0 || oldest == time)
+		return 0;
+
+	return count * (double)s2us(1) / (time - oldest);
+}
+
+static void
+wheel_reset(struct libinput_device *device)
+{
+	memset(device->wheel.clicks, 0, sizeof(device->wheel.clicks));
+	device->wheel.direction = 0;
+}
+
+static void
+wheel_timeout(uint64_t now, void *data)
+{
+	wheel_flush(data);
+}
+
+void
+wheel_init(struct libinput_device *device)
+{
+	libinput_timer_init(&device->wheel.timer, device->seat->libinput,
+			    wheel_timeout, device);
+}
+
+/* Post the clicks held back so far */
+void
+wheel_flush(struct libinput_device *device)
+{
+	if (device->wheel.pending == 0)
+		return;
+
+	libinput_timer_cancel(&device->wheel.timer);
+	wheel_post(device, device->wheel.time, device->wheel.delta);
+	device->wheel.pending = 0;
+	device->wheel.delta = 0;
+}
+
+void
+wheel_process(struct libinput_device *device, uint64_t time, int value)
+{
+	struct libinput *libinput = device->seat->libinput;
+	unsigned int n = ARRAY_LENGTH(device->wheel.clicks);
+	double rate, factor;
+	int direction;
+
+	if (!device->wheel.enabled || value == 0) {
+		wheel_post(device, time, value * WHEEL_CLICK_UNITS);
+		return;
+	}
+
+	/* Turning the wheel back is never accelerated */
+	direction = value < 0 ? -1 : 1;
+	if (direction != device->wheel.direction) {
+		wheel_flush(device);
+		wheel_reset(device);
+		device->wheel.direction = direction;
+	}
+
+	device->wheel.cur = (device->wheel.cur + 1) % n;
+	device->wheel.clicks[device->wheel.cur] = time;
+
+	rate = wheel_rate(device, time);
+	if (rate <= WHEEL_ACCEL_THRESHOLD) {
+		wheel_flush(device);
+		wheel_post(device, time, value * WHEEL_CLICK_UNITS);
+		return;
+	}
+
+	factor = min(WHEEL_ACCEL_MAX,
+		     1 + (rate - WHEEL_ACCEL_THRESHOLD) * WHEEL_ACCEL_INCLINE);
+
+	/* The timer runs on the context clock, the events on record time */
+	if (device->wheel.pending == 0)
+		libinput_timer_set(&device->wheel.timer,
+				   libinput_now(libinput) +
+				   WHEEL_MERGE_INTERVAL);
+
+	device->wheel.pending += value;
+	device->wheel.delta += value * WHEEL_CLICK_UNITS * factor;
+	device->wheel.time = time;
+}
+
+/* Post what is held back and forget the clicks, before a close */
+void
+wheel_release(struct libinput_device *device)
+{
+	wheel_flush(device);
+	wheel_reset(device);
+}
+
+LIBINPUT_EXPORT int
+libinput_device_set_wheel_acceleration(struct libinput_device *device,
+				       int enable)
+{
+	if (!(device->caps & bit(LIBINPUT_DEVICE_CAP_POINTER)))
+		return -EINVAL;
+
+	wheel_release(device);
+	device->wheel.enabled = enable;
+
+	return 0;
+}
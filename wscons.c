@@ -21,9 +21,13 @@
  * DEALINGS IN THE SOFTWARE.
  */
 
+#include <sys/ioctl.h>
+
 #include <assert.h>
+#include <errno.h>
 #include <fcntl.h>
 #include <stdarg.h>
+#include <stdlib.h>
 #include <string.h>
 #include <time.h>
 
@@ -40,6 +44,205 @@ extern uint32_t wskey_transcode(int);
 
 static int old_value = -1;
 
+/* Size of the kernel event queue, see WSEVENT_QSIZE in wseventvar.h */
+#define WSCONS_KERNEL_QSIZE	256
+#define WSCONS_READ_RECORDS	32
+
+/* Units of a rate limit token, refilled at the rate per microsecond */
+#define WSCONS_TOKEN_SCALE	1000000
+
+/* Relative motion of a sweep across an axis of unknown resolution */
+#define WSCONS_ABS_TO_REL_SPAN	2000.0
+
+/* A position this far from the last one re-entered, it did not move there */
+#define WSCONS_ABS_TO_REL_JUMP	0.25	/* of the axis range */
+
+/*
+ * Fill mask with the keys and buttons the kernel reports as held down.
+ * wscons(4) has no ioctl returning that state, the kernel forgets about
+ * held keys when its queue overflows so we assume all of them have been
+ * released. Anything still held is reported again on its next press.
+ */
+static void
+wscons_query_state(struct libinput_device *device, unsigned long *mask)
+{
+	memset(mask, 0, sizeof(device->key_mask));
+}
+
+/*
+ * Emit a release for every key and button held on the device that is not
+ * set in state.
+ */
+static void
+wscons_release_keys(struct libinput_device *device,
+		    uint64_t time,
+		    const unsigned long *state)
+{
+	size_t i;
+	int code;
+
+	device->releasing = true;
+	for (i = 0; i < ARRAY_LENGTH(device->key_mask); i++) {
+		if (device->key_mask[i] == state[i])
+			continue;
+
+		for (code = i * LONG_BITS; code < (int)((i + 1) * LONG_BITS);
+		     code++) {
+			if (!long_bit_is_set(device->key_mask, code) ||
+			    long_bit_is_set(state, code))
+				continue;
+
+			if (code >= BTN_MISC && code < KEY_OK)
+				pointer_notify_button(device, time, code,
+				    LIBINPUT_BUTTON_STATE_RELEASED);
+			else
+				keyboard_notify_key(device, time, code,
+				    LIBINPUT_KEY_STATE_RELEASED);
+		}
+	}
+	device->releasing = false;
+
+	old_value = -1;
+}
+
+/*
+ * Bring the tracked key and button state in line with the kernel after
+ * events may have been lost, emitting the missing releases.
+ */
+static void
+wscons_resync(struct libinput_device *device, uint64_t time)
+{
+	unsigned long state[NLONGS(KEY_CNT)];
+
+	wscons_query_state(device, state);
+	wscons_release_keys(device, time, state);
+}
+
+static uint64_t
+wscons_time(const struct wscons_event *wsevent)
+{
+	return s2us(wsevent->time.tv_sec) + ns2us(wsevent->time.tv_nsec);
+}
+
+/*
+ * Take a rate limit token for an event at the given time. Refilling uses
+ * the record timestamps, which saves a clock read per event.
+ */
+static bool
+wscons_rate_limit_take(struct libinput_device *device, uint64_t time)
+{
+	struct libinput *libinput = device->seat->libinput;
+	uint64_t max;
+
+	if (device->limit.rate == 0)
+		return true;
+
+	/* The bucket starts full, the first event only sets the time */
+	if (device->limit.last != 0 && time > device->limit.last) {
+		max = (uint64_t)device->limit.burst * WSCONS_TOKEN_SCALE;
+		device->limit.tokens += (time - device->limit.last) *
+					device->limit.rate;
+		if (device->limit.tokens > max)
+			device->limit.tokens = max;
+	}
+	device->limit.last = time;
+
+	if (device->limit.tokens >= WSCONS_TOKEN_SCALE) {
+		device->limit.tokens -= WSCONS_TOKEN_SCALE;
+		return true;
+	}
+
+	log_info_ratelimit(libinput, &device->limit.log_limit,
+			   "%s: exceeding the rate limit of %u events/s\n",
+			   device->devname, device->limit.rate);
+	return false;
+}
+
+/* Events that are never dropped or merged, only counted */
+static void
+wscons_rate_limit_discrete(struct libinput_device *device, uint64_t time)
+{
+	if (!wscons_rate_limit_take(device, time))
+		device->stats.over_budget++;
+}
+
+/*
+ * Turn an absolute position into relative motion accumulated for the
+ * current frame. The first position after a reset is only a reference,
+ * so is one far away from the last: the pointer of a virtual machine
+ * tablet left the window and came back elsewhere.
+ */
+static void
+wscons_abs_to_rel(struct libinput_device *device,
+		  int axis,
+		  int value,
+		  uint64_t time)
+{
+	int min, max, res, range, delta;
+	double scale;
+
+	if (!device->abs_to_rel.valid[axis]) {
+		device->abs_to_rel.valid[axis] = true;
+		device->abs_to_rel.last[axis] = value;
+		return;
+	}
+
+	delta = value - device->abs_to_rel.last[axis];
+	device->abs_to_rel.last[axis] = value;
+	if (delta == 0)
+		return;
+
+	scale = 1;
+	if (device->abs.valid) {
+		min = axis ? device->abs.min.y : device->abs.min.x;
+		max = axis ? device->abs.max.y : device->abs.max.x;
+		res = axis ? device->abs.res.y : device->abs.res.x;
+		range = max - min + 1;
+
+		if (abs(delta) > range * WSCONS_ABS_TO_REL_JUMP)
+			return;
+
+		if (res > 0)
+			scale = MOTION_UNITS_PER_MM / res;
+		else
+			scale = WSCONS_ABS_TO_REL_SPAN / range;
+	}
+
+	if (axis)
+		device->motion.delta.y += delta * scale;
+	else
+		device->motion.delta.x += delta * scale;
+	device->motion.time = time;
+	device->motion.pending = true;
+}
+
+/* Post the motion accumulated over the current frame */
+static void
+wscons_flush_motion(struct libinput_device *device)
+{
+	struct normalized_coords accel;
+	struct device_float_coords raw;
+	double x, y;
+
+	if (!device->motion.pending)
+		return;
+
+	x = device->motion.delta.x;
+	y = device->motion.delta.y;
+	if (device->rotation.angle != 0)
+		matrix_mult_vec_double(&device->rotation.matrix, &x, &y);
+
+	raw.x = x;
+	raw.y = y;
+	filter_dispatch(device, &raw, device->motion.time, &accel);
+
+	device->motion.pending = false;
+	device->motion.delta.x = 0;
+	device->motion.delta.y = 0;
+
+	pointer_notify_motion(device, device->motion.time, &accel, &raw);
+}
+
 static void
 wscons_process(struct libinput_device *device, struct wscons_event *wsevent)
 {
@@ -50,7 +253,27 @@ wscons_process(struct libinput_device *device, struct wscons_event *wsevent)
 	uint64_t time;
 	int button, key;
 
-	time = s2us(wsevent->time.tv_sec) + ns2us(wsevent->time.tv_nsec);
+	time = wscons_time(wsevent);
+
+	/* Keep pending motion ordered before anything else in the frame */
+	if (device->motion.pending &&
+	    wsevent->type != WSCONS_EVENT_MOUSE_DELTA_X &&
+	    wsevent->type != WSCONS_EVENT_MOUSE_DELTA_Y &&
+	    wsevent->type != WSCONS_EVENT_MOUSE_ABSOLUTE_X &&
+	    wsevent->type != WSCONS_EVENT_MOUSE_ABSOLUTE_Y &&
+	    wsevent->type != WSCONS_EVENT_TOUCH_CONTACTS &&
+	    wsevent->type != WSCONS_EVENT_TOUCH_PRESSURE &&
+	    wsevent->type != WSCONS_EVENT_TOUCH_WIDTH &&
+	    wsevent->type != WSCONS_EVENT_SYNC)
+		wscons_flush_motion(device);
+
+	/* Motion is posted at the end of the frame, it may pass the clicks */
+	if (device->wheel.pending != 0 &&
+	    wsevent->type != WSCONS_EVENT_MOUSE_DELTA_X &&
+	    wsevent->type != WSCONS_EVENT_MOUSE_DELTA_Y &&
+	    wsevent->type != WSCONS_EVENT_MOUSE_DELTA_Z &&
+	    wsevent->type != WSCONS_EVENT_SYNC)
+		wheel_flush(device);
 
 	switch (wsevent->type) {
 	case WSCONS_EVENT_KEY_UP:
@@ -66,10 +289,15 @@ wscons_process(struct libinput_device *device, struct wscons_event *wsevent)
 				return;
 			old_value = key;
 		}
+		wscons_rate_limit_discrete(device, time);
 		keyboard_notify_key(device, time,
 				    wskey_transcode(key), kstate);
 		break;
 
+	case WSCONS_EVENT_ALL_KEYS_UP:
+		wscons_resync(device, time);
+		break;
+
 	case WSCONS_EVENT_MOUSE_UP:
 	case WSCONS_EVENT_MOUSE_DOWN:
 		/*
@@ -82,31 +310,48 @@ wscons_process(struct libinput_device *device, struct wscons_event *wsevent)
 			bstate = LIBINPUT_BUTTON_STATE_RELEASED;
 		else
 			bstate = LIBINPUT_BUTTON_STATE_PRESSED;
+		wscons_rate_limit_discrete(device, time);
 		pointer_notify_button(device, time, button, bstate);
 		break;
 
 	case WSCONS_EVENT_MOUSE_DELTA_X:
 	case WSCONS_EVENT_MOUSE_DELTA_Y:
-		memset(&raw, 0, sizeof(raw));
-		memset(&accel, 0, sizeof(accel));
+		if (device->raw.handler != NULL) {
+			device_notify_activity(device);
+			if (wsevent->type == WSCONS_EVENT_MOUSE_DELTA_X)
+				device->raw.handler(device, time,
+				    wsevent->value, 0, device->raw.user_data);
+			else
+				device->raw.handler(device, time,
+				    0, -wsevent->value, device->raw.user_data);
+			break;
+		}
 
+		/* x and y arrive as separate records, post them as one */
 		if (wsevent->type == WSCONS_EVENT_MOUSE_DELTA_X)
-			accel.x = wsevent->value;
+			device->motion.delta.x += wsevent->value;
 		else
-			accel.y = -wsevent->value;
-
-		pointer_notify_motion(device, time, &accel, &raw);
+			device->motion.delta.y -= wsevent->value;
+		device->motion.time = time;
+		device->motion.pending = true;
 		break;
 
 	case WSCONS_EVENT_MOUSE_DELTA_Z:
-		memset(&raw, 0, sizeof(raw));
-		accel.x = 0;
-		accel.y = wsevent->value * 32;
-		axis_notify_event(device, time, &accel, &raw);
+		wscons_rate_limit_discrete(device, time);
+		wheel_process(device, time, wsevent->value);
 		break;
 
 	case WSCONS_EVENT_MOUSE_ABSOLUTE_X:
 	case WSCONS_EVENT_MOUSE_ABSOLUTE_Y:
+		if (device->tp.native) {
+			if (wsevent->type == WSCONS_EVENT_MOUSE_ABSOLUTE_X)
+				device->tp.touch.point.x = wsevent->value;
+			else
+				device->tp.touch.point.y = wsevent->value;
+		} else if (device->abs_to_rel.enabled)
+			wscons_abs_to_rel(device,
+			    wsevent->type == WSCONS_EVENT_MOUSE_ABSOLUTE_Y,
+			    wsevent->value, time);
 		//return LIBINPUT_EVENT_POINTER_MOTION_ABSOLUTE;
 		break;
 
@@ -114,22 +359,49 @@ wscons_process(struct libinput_device *device, struct wscons_event *wsevent)
 		memset(&raw, 0, sizeof(raw));
 		accel.x = wsevent->value/8;
 		accel.y = 0;
+		wscons_rate_limit_discrete(device, time);
 		axis_notify_event(device, time, &accel, &raw);
 		break;
 	case WSCONS_EVENT_VSCROLL:
 		memset(&raw, 0, sizeof(raw));
 		accel.x = 0;
 		accel.y = wsevent->value/8;
+		wscons_rate_limit_discrete(device, time);
 		axis_notify_event(device, time, &accel, &raw);
 		break;
 	      
 	case WSCONS_EVENT_SYNC:
+		if (device->tp.native)
+			tp_process_frame(device, time);
+
+		/* Over budget, merge the motion into the next frame */
+		if (device->motion.pending &&
+		    !wscons_rate_limit_take(device, time)) {
+			device->stats.merged++;
+			break;
+		}
+		wscons_flush_motion(device);
 		break;
 
-	case WSCONS_EVENT_MOUSE_ABSOLUTE_Z:
-	case WSCONS_EVENT_MOUSE_ABSOLUTE_W:
-	case WSCONS_EVENT_TOUCH_WIDTH:
 	case WSCONS_EVENT_TOUCH_RESET:
+		/* the position was lost, the next one is a new reference */
+		device->abs_to_rel.valid[0] = false;
+		device->abs_to_rel.valid[1] = false;
+		device->tp.reset = true;
+		break;
+
+	/*
+	 * Also MOUSE_ABSOLUTE_W, the width of a tablet tool. Only native
+	 * touchpads report contacts with it.
+	 */
+	case WSCONS_EVENT_TOUCH_CONTACTS:
+		if (device->tp.native)
+			device->tp.fingers = wsevent->value;
+		break;
+
+	/* Also MOUSE_ABSOLUTE_Z, the pressure of a tablet tool */
+	case WSCONS_EVENT_TOUCH_PRESSURE:
+	case WSCONS_EVENT_TOUCH_WIDTH:
 		/* ignore those */
 		break;
 	default:
@@ -139,21 +411,146 @@ wscons_process(struct libinput_device *device, struct wscons_event *wsevent)
 	}
 }
 
+/*
+ * The records sat in the kernel queue from their timestamp until they were
+ * read, both taken from CLOCK_REALTIME.
+ */
+static void
+wscons_account_latency(struct libinput_device *device,
+		       const struct wscons_event *wsevents,
+		       int count,
+		       uint64_t read_time)
+{
+	uint64_t time, latency;
+	int i;
+
+	for (i = 0; i < count; i++) {
+		time = wscons_time(&wsevents[i]);
+		if (read_time <= time)
+			continue;
+
+		latency = read_time - time;
+		device->stats.read_latency_total += latency;
+		if (latency > device->stats.read_latency_max)
+			device->stats.read_latency_max = latency;
+	}
+}
+
+/* Decode a batch of records, read by the dispatch or the busy-poll thread */
+void
+wscons_device_process(struct libinput_device *device,
+		      struct wscons_event *wsevents,
+		      int count,
+		      uint64_t read_time)
+{
+	struct libinput *libinput = device->seat->libinput;
+	uint64_t trace_time, frame_time = 0;
+	int i, nframe = 0;
+
+	device->stats.records += count;
+	device->read_now = libinput_now(libinput);
+	wscons_account_latency(device, wsevents, count, read_time);
+	if (device->recorder != NULL)
+		flight_recorder_append(device->recorder, wsevents, count);
+
+        for (i = 0; i < count; i++) {
+		trace_time = trace_begin(libinput);
+		if (nframe++ == 0)
+			frame_time = trace_time;
+
+		wscons_process(device, &wsevents[i]);
+
+		trace_end(libinput, TRACE_SPAN_DECODE, trace_time,
+		    wsevents[i].type);
+		if (wsevents[i].type == WSCONS_EVENT_SYNC) {
+			trace_end(libinput, TRACE_SPAN_FRAME, frame_time,
+			    nframe);
+			nframe = 0;
+		}
+	}
+
+	/* Drained, do not hold motion merged by the rate limit back */
+	if (device->motion.pending && count < WSCONS_READ_RECORDS &&
+	    wsevents[count - 1].type == WSCONS_EVENT_SYNC)
+		wscons_flush_motion(device);
+
+	device->last_time = wscons_time(&wsevents[count - 1]);
+}
+
+/*
+ * wscons(4) has no equivalent of SYN_DROPPED, records arriving while the
+ * kernel queue is full are silently dropped. Each wakeup drains the queue,
+ * if that takes a whole queue worth of records it was full and records
+ * may have been lost. The state is resynced after the surviving records.
+ */
 static void
 wscons_device_dispatch(void *data)
 {
 	struct libinput_device *device = data;
-	struct wscons_event wsevents[32];
+	struct libinput *libinput = device->seat->libinput;
+	struct wscons_event wsevents[WSCONS_READ_RECORDS];
+	struct timespec ts;
+	uint64_t trace_time;
+	unsigned int total = 0;
 	ssize_t len;
-	int count, i;
+	int count = 0;
 
-	len = read(device->fd, wsevents, sizeof(struct wscons_event));
-	if (len <= 0 || (len % sizeof(struct wscons_event)) != 0)
-		return;
+	do {
+		trace_time = trace_begin(libinput);
+		len = read(device->fd, wsevents, sizeof(wsevents));
+		trace_end(libinput, TRACE_SPAN_READ, trace_time, device->fd);
+		if (len <= 0 || (len % sizeof(struct wscons_event)) != 0)
+			break;
 
-	count = len / sizeof(struct wscons_event);
-        for (i = 0; i < count; i++) {
-		wscons_process(device, &wsevents[i]);
+		count = len / sizeof(struct wscons_event);
+		clock_gettime(CLOCK_REALTIME, &ts);
+		wscons_device_process(device, wsevents, count,
+				      s2us(ts.tv_sec) + ns2us(ts.tv_nsec));
+		total += count;
+	} while (count == WSCONS_READ_RECORDS && total < WSCONS_KERNEL_QSIZE);
+
+	/* The kernel queue holds one record less than its size */
+	if (total >= WSCONS_KERNEL_QSIZE - 1) {
+		log_info(libinput,
+			 "%s: kernel event queue overflow, resyncing state\n",
+			 device->devname);
+		device->stats.overflows++;
+		wscons_resync(device, device->last_time);
+	}
+}
+
+/* Have the records of an open device read by kqueue or busy-polling */
+int
+wscons_device_listen(struct libinput_device *device)
+{
+	struct libinput *libinput = device->seat->libinput;
+	libinput_source_dispatch_t dispatch = wscons_device_dispatch;
+
+	/* The busy-poll thread only knows wscons records */
+	if (device->evdev.enabled)
+		dispatch = evdev_device_dispatch;
+	else if (libinput->busypoll != NULL &&
+		 busypoll_add(libinput, device) == 0)
+		return 0;
+
+	device->source = libinput_add_fd(libinput, device->fd, dispatch,
+					 device);
+
+	return device->source ? 0 : -ENOMEM;
+}
+
+/* Stop reading the device, its fd may be closed afterwards */
+void
+wscons_device_unlisten(struct libinput_device *device)
+{
+	struct libinput *libinput = device->seat->libinput;
+
+	if (device->busypoll_slot != -1)
+		busypoll_remove(libinput, device);
+
+	if (device->source) {
+		libinput_remove_source(libinput, device->source);
+		device->source = NULL;
 	}
 }
 
@@ -182,6 +579,361 @@ wscons_seat_get(struct libinput *libinput, const char *seat_name_physical,
 	return seat;
 }
 
+static uint32_t
+wscons_device_caps(const char *path)
+{
+	if (strncmp(path, "/dev/wsmouse", 12) == 0)
+		return bit(LIBINPUT_DEVICE_CAP_POINTER);
+	if (strncmp(path, "/dev/wskbd", 10) == 0)
+		return bit(LIBINPUT_DEVICE_CAP_KEYBOARD);
+
+	return 0;
+}
+
+static void
+wscons_device_open_deferred(uint64_t now, void *data);
+
+/*
+ * wscons does not tell which hardware a device belongs to. The internal
+ * keyboard and the PS/2 mouse or touchpad of a laptop share the pckbc(4)
+ * controller, any other device stays in a group of its own.
+ */
+static bool
+wscons_device_group_id(struct libinput_device *device, char *id, size_t len)
+{
+	if (device->caps & bit(LIBINPUT_DEVICE_CAP_KEYBOARD)) {
+		if (device->wstype != WSKBD_TYPE_PC_XT &&
+		    device->wstype != WSKBD_TYPE_PC_AT)
+			return false;
+	} else {
+		switch (device->wstype) {
+		case WSMOUSE_TYPE_PS2:
+		case WSMOUSE_TYPE_SYNAPTICS:
+		case WSMOUSE_TYPE_SYNAP_SBTN:
+		case WSMOUSE_TYPE_ALPS:
+		case WSMOUSE_TYPE_ELANTECH:
+			break;
+		default:
+			return false;
+		}
+	}
+
+	return snprintf(id, len, "pckbc") < (int)len;
+}
+
+/* Join the group of the other devices of the same hardware, once probed */
+static void
+wscons_device_update_group(struct libinput_device *device)
+{
+	struct libinput *libinput = device->seat->libinput;
+	struct libinput_device_group *group;
+	char id[128];
+	bool found;
+
+	if (device->evdev.enabled)
+		found = evdev_device_group_id(device, id, sizeof(id));
+	else
+		found = wscons_device_group_id(device, id, sizeof(id));
+	if (!found)
+		return;
+
+	if (device->group->identifier != NULL &&
+	    streq(device->group->identifier, id))
+		return;
+
+	group = libinput_device_group_find_group(libinput, id);
+	if (group != NULL) {
+		libinput_device_set_device_group(device, group);
+		return;
+	}
+
+	group = libinput_device_group_create(libinput, id);
+	if (group == NULL)
+		return;
+	libinput_device_set_device_group(device, group);
+	libinput_device_group_unref(group);
+}
+
+/*
+ * Set up a device from its path alone. This does not touch the device
+ * node, opening and probing is done by wscons_device_open().
+ */
+static struct libinput_device *
+wscons_device_create(struct libinput *libinput, const char *path)
+{
+	struct libinput_seat *seat;
+	struct libinput_device *device;
+	struct libinput_device_group *group;
+
+	device = calloc(1, sizeof(*device));
+	if (device == NULL)
+		return NULL;
+
+	device->fd = -1;
+	device->busypoll_slot = -1;
+	device->evdev.enabled = evdev_is_device_path(path);
+	device->accel.profile = LIBINPUT_CONFIG_ACCEL_PROFILE_ADAPTIVE;
+	device->accel.dirty = true;
+	device->devname = strdup(path);
+	if (device->devname == NULL) {
+		free(device);
+		return NULL;
+	}
+
+	/* On its own until probing finds the rest of the hardware */
+	group = libinput_device_group_create(libinput, NULL);
+	if (group == NULL) {
+		free(device->devname);
+		free(device);
+		return NULL;
+	}
+
+	/* Only one (default) seat is supported. */
+	seat = wscons_seat_get(libinput, default_seat, default_seat_name);
+	if (seat == NULL) {
+		libinput_device_group_unref(group);
+		free(device->devname);
+		free(device);
+		return NULL;
+	}
+
+	libinput_device_init(device, seat);
+	libinput_device_set_device_group(device, group);
+	libinput_device_group_unref(group);
+	device->caps = wscons_device_caps(path);
+	if (libinput->recorder_size != 0)
+		device->recorder = flight_recorder_create(libinput->recorder_size);
+	libinput_timer_init(&device->open_timer, libinput,
+			    wscons_device_open_deferred, device);
+	tp_init(device);
+	wheel_init(device);
+	ratelimit_init(&device->limit.log_limit, 5000, 1);
+	list_insert(&seat->devices_list, &device->link);
+
+	return device;
+}
+
+static void
+wscons_device_probe(struct libinput_device *device)
+{
+	struct wsmouse_calibcoords coords;
+
+	if (device->caps & bit(LIBINPUT_DEVICE_CAP_KEYBOARD)) {
+		if (ioctl(device->fd, WSKBDIO_GTYPE, &device->wstype) == -1)
+			device->wstype = 0;
+
+		/* The layout may have changed while the device was closed */
+		keymap_unref(device->keymap);
+		device->keymap = keymap_get(device->seat->libinput, device->fd);
+		memset(&device->keymap_state, 0, sizeof(device->keymap_state));
+		return;
+	}
+
+	if (ioctl(device->fd, WSMOUSEIO_GTYPE, &device->wstype) == -1)
+		device->wstype = 0;
+
+	if (ioctl(device->fd, WSMOUSEIO_GCALIBCOORDS, &coords) == 0 &&
+	    coords.maxx > coords.minx && coords.maxy > coords.miny) {
+		device->abs.valid = true;
+		device->abs.min.x = coords.minx;
+		device->abs.min.y = coords.miny;
+		device->abs.max.x = coords.maxx;
+		device->abs.max.y = coords.maxy;
+		device->abs.res.x = coords.resx;
+		device->abs.res.y = coords.resy;
+	}
+
+	tp_update_mode(device);
+}
+
+static int
+wscons_device_open(struct libinput_device *device)
+{
+	struct libinput *libinput = device->seat->libinput;
+	int fd;
+
+	if (device->fd != -1)
+		return 0;
+
+	fd = open_restricted(libinput, device->devname,
+			     O_RDWR | O_NONBLOCK | O_CLOEXEC);
+	if (fd < 0) {
+		log_info(libinput,
+			 "opening input device '%s' failed (%s).\n",
+			 device->devname, strerror(-fd));
+		return fd;
+	}
+
+	device->fd = fd;
+	if (device->evdev.enabled)
+		evdev_device_probe(device);
+	else
+		wscons_device_probe(device);
+	wscons_device_update_group(device);
+	device->abs_to_rel.valid[0] = false;
+	device->abs_to_rel.valid[1] = false;
+
+	if (wscons_device_listen(device) != 0) {
+		close_restricted(libinput, fd);
+		device->fd = -1;
+		return -ENOMEM;
+	}
+
+	return 0;
+}
+
+/*
+ * The type is probed on open and kept while the device is suspended. The
+ * wsmouse mux never reports a touchpad type, so on the udev seat nothing
+ * offers LIBINPUT_CONFIG_SEND_EVENTS_DISABLED_ON_EXTERNAL_MOUSE.
+ */
+bool
+wscons_device_is_touchpad(struct libinput_device *device)
+{
+	if (!(device->caps & bit(LIBINPUT_DEVICE_CAP_POINTER)))
+		return false;
+
+	switch (device->wstype) {
+	case WSMOUSE_TYPE_SYNAPTICS:
+	case WSMOUSE_TYPE_SYNAP_SBTN:
+	case WSMOUSE_TYPE_ALPS:
+	case WSMOUSE_TYPE_ELANTECH:
+	case WSMOUSE_TYPE_TOUCHPAD:
+		return true;
+	}
+
+	return false;
+}
+
+/* The mux aggregates all mice, including the touchpad itself */
+static bool
+wscons_seat_has_external_mouse(struct libinput_seat *seat)
+{
+	struct libinput_device *device;
+
+	list_for_each(device, &seat->devices_list, link) {
+		if (device->fd != -1 &&
+		    (device->caps & bit(LIBINPUT_DEVICE_CAP_POINTER)) &&
+		    !wscons_device_is_touchpad(device) &&
+		    !streq(device->devname, "/dev/wsmouse"))
+			return true;
+	}
+
+	return false;
+}
+
+/* The internal keyboard and touchpad share the pckbc(4) group */
+static bool
+wscons_device_is_internal(struct libinput_device *device)
+{
+	const char *id = device->group->identifier;
+
+	return id != NULL && streq(id, "pckbc");
+}
+
+/*
+ * Take the device out of the event loop: release what it holds, stop
+ * listening and close it so it costs neither wakeups nor reads.
+ */
+static void
+wscons_device_suspend(struct libinput_device *device)
+{
+	struct libinput *libinput = device->seat->libinput;
+	unsigned long none[NLONGS(KEY_CNT)] = { 0 };
+
+	wscons_device_unlisten(device);
+	tp_release(device, device->last_time);
+	evdev_device_release(device, device->last_time);
+	wheel_release(device);
+	wscons_flush_motion(device);
+	wscons_release_keys(device, device->last_time, none);
+	libinput_timer_cancel(&device->open_timer);
+
+	if (device->fd != -1) {
+		close_restricted(libinput, device->fd);
+		device->fd = -1;
+	}
+}
+
+void
+wscons_device_update_send_events(struct libinput_device *device)
+{
+	bool suspend;
+
+	if (device->sendevents_mode & LIBINPUT_CONFIG_SEND_EVENTS_DISABLED)
+		suspend = true;
+	else if (device->sendevents_mode &
+		 LIBINPUT_CONFIG_SEND_EVENTS_DISABLED_ON_EXTERNAL_MOUSE)
+		suspend = wscons_seat_has_external_mouse(device->seat);
+	else
+		suspend = false;
+
+	/* Nothing can reach them with the lid closed */
+	if (device->seat->lid_closed && wscons_device_is_internal(device))
+		suspend = true;
+
+	if (suspend == device->suspended)
+		return;
+
+	if (suspend)
+		wscons_device_suspend(device);
+	else if (wscons_device_open(device) != 0)
+		return;
+
+	device->suspended = suspend;
+}
+
+/*
+ * A device came or went, re-evaluate the touchpads, and the internal
+ * devices in case one of them was opened with the lid closed.
+ */
+static void
+wscons_seat_update_send_events(struct libinput_seat *seat)
+{
+	struct libinput_device *device;
+
+	list_for_each(device, &seat->devices_list, link) {
+		if ((device->sendevents_mode &
+		     LIBINPUT_CONFIG_SEND_EVENTS_DISABLED_ON_EXTERNAL_MOUSE) ||
+		    (seat->lid_closed && wscons_device_is_internal(device)))
+			wscons_device_update_send_events(device);
+	}
+}
+
+void
+wscons_seat_set_lid_closed(struct libinput_seat *seat, bool closed)
+{
+	struct libinput_device *device;
+
+	if (seat->lid_closed == closed)
+		return;
+
+	seat->lid_closed = closed;
+	list_for_each(device, &seat->devices_list, link) {
+		if (wscons_device_is_internal(device))
+			wscons_device_update_send_events(device);
+	}
+}
+
+static void
+wscons_device_open_deferred(uint64_t now, void *data)
+{
+	struct libinput_device *device = data;
+	struct libinput_event *event;
+
+	if (wscons_device_open(device) == 0) {
+		wscons_seat_update_send_events(device->seat);
+		return;
+	}
+
+	/* Already announced, take it back */
+	event = libinput_event_alloc(device->seat->libinput);
+	if (event != NULL)
+		post_device_event(device, now, LIBINPUT_EVENT_DEVICE_REMOVED,
+		    event);
+	libinput_device_unref(device);
+}
+
 LIBINPUT_EXPORT struct libinput *
 libinput_udev_create_context(const struct libinput_interface *interface,
 	void *user_data, struct udev *udev)
@@ -203,27 +955,35 @@ libinput_udev_create_context(const struct libinput_interface *interface,
 LIBINPUT_EXPORT int
 libinput_udev_assign_seat(struct libinput *libinput, const char *seat_id)
 {
-
-	struct libinput_seat *seat;
+	static const char *muxes[] = { "/dev/wskbd", "/dev/wsmouse" };
 	struct libinput_device *device;
 	uint64_t time;
-	struct timespec ts;
 	struct libinput_event *event;
+	size_t i;
 
 	fprintf(stderr, "%s: %d\n", __func__, __LINE__);
 
-	/* Add standard muxes */
-	libinput_path_add_device(libinput, "/dev/wskbd");
-	libinput_path_add_device(libinput, "/dev/wsmouse");
+	/*
+	 * Announce the standard muxes without opening them. Opening and
+	 * probing is deferred to the first libinput_dispatch() so a slow
+	 * device does not hold up the caller.
+	 */
+	time = libinput_now(libinput);
+	for (i = 0; i < ARRAY_LENGTH(muxes); i++) {
+		if (access(muxes[i], F_OK) == -1)
+			continue;
+
+		device = wscons_device_create(libinput, muxes[i]);
+		if (device == NULL)
+			continue;
 
-	seat = wscons_seat_get(libinput, default_seat, default_seat_name);
-	list_for_each(device, &seat->devices_list, link) {
 		fprintf(stderr, "   %s\n", device->devname);
-		clock_gettime(CLOCK_REALTIME, &ts);
-		time = s2us(ts.tv_sec) + ns2us(ts.tv_nsec);
-		event = calloc(1, sizeof(*event));
-		post_device_event(device, time, LIBINPUT_EVENT_DEVICE_ADDED,
-		    event);
+		event = libinput_event_alloc(libinput);
+		if (event != NULL)
+			post_device_event(device, time,
+			    LIBINPUT_EVENT_DEVICE_ADDED, event);
+
+		libinput_timer_set(&device->open_timer, time);
 	}
 	return 0;
 }
@@ -247,52 +1007,73 @@ libinput_path_create_context(const struct libinput_interface *interface,
 	return libinput;
 }
 
+LIBINPUT_EXPORT int
+libinput_device_set_raw_motion_handler(struct libinput_device *device,
+				       libinput_raw_motion_handler handler,
+				       void *user_data)
+{
+	if (!(device->caps & bit(LIBINPUT_DEVICE_CAP_POINTER)))
+		return -EINVAL;
+
+	/* Queue what the regular path accumulated so far */
+	wscons_flush_motion(device);
+
+	device->raw.handler = handler;
+	device->raw.user_data = user_data;
+
+	return 0;
+}
+
+LIBINPUT_EXPORT int
+libinput_device_set_rate_limit(struct libinput_device *device,
+			       unsigned int rate,
+			       unsigned int burst)
+{
+	if (rate != 0 && burst == 0)
+		return -EINVAL;
+
+	/* Start with a full bucket */
+	device->limit.rate = rate;
+	device->limit.burst = burst;
+	device->limit.tokens = (uint64_t)burst * WSCONS_TOKEN_SCALE;
+	device->limit.last = 0;
+
+	return 0;
+}
+
+LIBINPUT_EXPORT int
+libinput_device_get_stats(struct libinput_device *device,
+			  struct libinput_device_stats *stats,
+			  size_t size)
+{
+	if (size < sizeof(stats->size))
+		return -EINVAL;
+
+	size = min(size, sizeof(device->stats));
+	device->stats.size = size;
+	memcpy(stats, &device->stats, size);
+
+	return size;
+}
+
 LIBINPUT_EXPORT struct libinput_device *
 libinput_path_add_device(struct libinput *libinput,
 	const char *path)
 {
-	struct libinput_seat *seat = NULL;
 	struct libinput_device *device;
-	int fd;
-
-	fd = open_restricted(libinput, path,
-			     O_RDWR | O_NONBLOCK | O_CLOEXEC);
-	if (fd < 0) {
-		log_info(libinput,
-			 "opening input device '%s' failed (%s).\n",
-			 path, strerror(-fd));
-		return NULL;
-	}
 
-	device = calloc(1, sizeof(*device));
+	device = wscons_device_create(libinput, path);
 	if (device == NULL)
 		return NULL;
 
-	/* Only one (default) seat is supported. */
-	seat = wscons_seat_get(libinput, default_seat, default_seat_name);
-	if (seat == NULL)
-		goto err;
-
-	libinput_device_init(device, seat);
-
-	device->fd = fd;
-	device->devname = strdup(path);
-	if (device->devname == NULL)
-		goto err;
-
-	device->source =
-		libinput_add_fd(libinput, fd, wscons_device_dispatch, device);
-	if (!device->source)
-		goto err;
+	if (wscons_device_open(device) != 0) {
+		libinput_device_unref(device);
+		return NULL;
+	}
 
-	list_insert(&seat->devices_list, &device->link);
+	wscons_seat_update_send_events(device->seat);
 
 	return device;
-
-err:
-	close_restricted(libinput, device->fd);
-	free(device);
-	return NULL;
 }
 
 LIBINPUT_EXPORT void
@@ -300,11 +1081,17 @@ libinput_path_remove_device(struct libinput_device *device)
 {
 	struct libinput *libinput = device->seat->libinput;
 
-	libinput_remove_source(libinput, device->source);
-	device->source = NULL;
+	libinput_timer_cancel(&device->open_timer);
+	wscons_device_unlisten(device);
+	tp_release(device, device->last_time);
+	evdev_device_release(device, device->last_time);
+	wheel_release(device);
 
-	close_restricted(libinput, device->fd);
-	device->fd = -1;
+	if (device->fd != -1) {
+		close_restricted(libinput, device->fd);
+		device->fd = -1;
+	}
 
+	wscons_seat_update_send_events(device->seat);
 	libinput_device_unref(device);
 }